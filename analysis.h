@@ -0,0 +1,366 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+#include "decoder.h"
+
+
+// bloco basico do grafo de controle: instrucoes em linha reta de addr ate end
+struct CodeBlock {
+    uint16_t addr;
+    uint32_t end;          // byte seguinte a ultima instrucao
+    uint16_t instructions;
+    uint8_t last_op;
+    uint8_t succ_count;    // sucessores na mesma rotina: fallthrough, desvio, os dois lados
+    uint32_t succ[2];      // de um skip, o retorno de um CALL
+    bool calls;            // termina em CALL call_target
+    uint16_t call_target;
+};
+
+// destino de um CALL; blocks sao os alcancaveis a partir da entrada sem entrar em outros CALL
+struct Subroutine {
+    uint16_t entry;
+    unsigned int call_sites;
+    bool returns;          // algum caminho chega a um RET
+    std::vector<uint32_t> blocks; // indices em ProgramAnalysis::blocks()
+};
+
+// FX33/FX55/5XY2; target < 0 quando I nao e conhecido ali
+struct StoreSite {
+    uint16_t addr;
+    uint8_t op;
+    int32_t target;
+    uint16_t length;
+    bool hits_code;        // escreve sobre instrucoes alcancaveis: codigo auto-modificavel
+};
+
+// ANNN / F000 NNNN: I aponta para target
+struct DataRef {
+    uint16_t addr;
+    uint16_t target;
+    bool in_code;          // o alvo e uma instrucao alcancavel: dado no meio do codigo
+};
+
+
+// analise estatica de uma imagem de memoria: segue o fluxo de controle a partir da
+// entrada (desvios, chamadas e seus retornos, os dois lados de cada skip), corta o
+// codigo alcancavel em blocos basicos, acha as sub-rotinas e marca o que a execucao
+// pode estranhar: BNNN sem destino conhecido, ANNN apontando para codigo, instrucoes
+// desalinhadas que se sobrepoem, escritas (com I conhecido no bloco) sobre codigo e
+// saidas do programa carregado (que caem na memoria vazia, feita de 0NNN ignorados).
+// I so e acompanhado dentro de cada bloco (ANNN ... FX55); fora disso fica desconhecido.
+// Linear na memoria: cabe na carga da ROM e em varreduras de milhares de ROMs.
+template <typename Variant>
+class ProgramAnalysis {
+    public:
+        static constexpr unsigned int MEMORY_SIZE = Variant::MEMORY_SIZE;
+
+        // marcas por byte
+        static const uint8_t BYTE_CODE = 1;     // faz parte de uma instrucao alcancavel
+        static const uint8_t BYTE_ENTRY = 2;    // primeiro byte de uma instrucao alcancavel
+        static const uint8_t BYTE_LEADER = 4;   // inicio de bloco
+        static const uint8_t BYTE_DATA_REF = 8; // alvo de ANNN / F000 NNNN
+        static const uint8_t BYTE_WRITTEN = 16; // escrito por FX33/FX55/5XY2 com I conhecido
+        static const uint8_t BYTE_EXIT = 32;    // o fluxo chega aqui, alem do fim do programa
+
+        // memory: imagem inteira (MEMORY_SIZE bytes); end: fim do programa carregado.
+        // O fluxo que passa de end vai para exits() em vez de ser seguido pela memoria.
+        void analyze(const uint8_t* memory, uint16_t entry, size_t end = MEMORY_SIZE){
+            image = memory;
+            code_end = end;
+            byte_flags.assign(MEMORY_SIZE, 0);
+            block_index.assign(MEMORY_SIZE, -1);
+            call_counts.assign(MEMORY_SIZE, 0);
+            leaders.clear();
+            call_targets.clear();
+            code_blocks.clear();
+            routines.clear();
+            indirect_jumps.clear();
+            store_sites.clear();
+            data_refs.clear();
+            overlapping.clear();
+            exit_targets.clear();
+            instruction_count = 0;
+
+            explore(entry);
+            cutBlocks();
+            trackI();
+            findSubroutines();
+            findOverlaps();
+        }
+
+        uint8_t flags(size_t addr) const {
+            return byte_flags[addr];
+        }
+
+        bool isEntry(size_t addr) const {
+            return (byte_flags[addr] & BYTE_ENTRY) != 0;
+        }
+
+        bool isLeader(size_t addr) const {
+            return (byte_flags[addr] & BYTE_LEADER) != 0;
+        }
+
+        bool isCode(size_t addr) const {
+            return (byte_flags[addr] & BYTE_CODE) != 0;
+        }
+
+        // quantos CALL alcancaveis apontam para addr
+        unsigned int callSites(size_t addr) const {
+            return call_counts[addr];
+        }
+
+        // indice do bloco que comeca em addr, ou -1
+        int32_t blockAt(size_t addr) const {
+            return block_index[addr];
+        }
+
+        const std::vector<CodeBlock>& blocks() const { return code_blocks; }
+        const std::vector<Subroutine>& subroutines() const { return routines; }
+        const std::vector<uint16_t>& indirectJumps() const { return indirect_jumps; }
+        const std::vector<StoreSite>& stores() const { return store_sites; }
+        const std::vector<DataRef>& dataRefs() const { return data_refs; }
+        const std::vector<uint16_t>& overlaps() const { return overlapping; } // pares addr / addr+1
+        const std::vector<uint16_t>& exits() const { return exit_targets; }
+        size_t instructions() const { return instruction_count; }
+
+        DecodedInstr decodeAt(size_t addr) const {
+            return decodeOpcode<Variant>(word(addr));
+        }
+
+        // palavra seguinte (operando de F000 NNNN); 0 no fim da memoria
+        uint16_t longOperand(size_t addr) const {
+            return addr + 3 < MEMORY_SIZE ? word(addr + 2) : 0;
+        }
+
+    private:
+        const uint8_t* image = nullptr;
+        std::vector<uint8_t> byte_flags;
+        std::vector<int32_t> block_index;
+        std::vector<uint16_t> call_counts;
+        std::vector<CodeBlock> code_blocks;
+        std::vector<Subroutine> routines;
+        std::vector<uint16_t> indirect_jumps;
+        std::vector<StoreSite> store_sites;
+        std::vector<DataRef> data_refs;
+        std::vector<uint16_t> overlapping;
+        std::vector<uint16_t> exit_targets;
+        size_t code_end = MEMORY_SIZE;
+        size_t instruction_count = 0;
+        std::vector<size_t> pending;
+        std::vector<uint16_t> leaders;
+        std::vector<uint16_t> call_targets;
+        std::vector<uint32_t> seen;    // marca por bloco da busca em findSubroutines
+
+        uint16_t word(size_t addr) const {
+            return static_cast<uint16_t>(image[addr] << 8 | image[addr + 1]);
+        }
+
+        static bool fits(size_t addr){
+            return addr <= MEMORY_SIZE - 2;
+        }
+
+        // destino de um skip tomado: XO-CHIP pula os 4 bytes de F000 NNNN
+        size_t skipTarget(size_t addr) const {
+            size_t next = addr + 2;
+            if constexpr (Variant::XO_CHIP){
+                if (fits(next) && word(next) == 0xF000){
+                    return next + 4;
+                }
+            }
+            return next + 2;
+        }
+
+        bool inProgram(size_t addr) const {
+            return addr < code_end && fits(addr);
+        }
+
+        void addExit(size_t addr){
+            if (!(byte_flags[addr] & BYTE_EXIT)){
+                byte_flags[addr] |= BYTE_EXIT;
+                exit_targets.push_back(static_cast<uint16_t>(addr));
+            }
+        }
+
+        void addLeader(size_t addr){
+            if (fits(addr) && addr >= code_end){
+                addExit(addr);
+            } else if (fits(addr) && !(byte_flags[addr] & BYTE_LEADER)){
+                byte_flags[addr] |= BYTE_LEADER;
+                leaders.push_back(static_cast<uint16_t>(addr));
+                pending.push_back(addr);
+            }
+        }
+
+        void explore(uint16_t entry){
+            pending.clear();
+            addLeader(entry);
+            while (!pending.empty()){
+                size_t addr = pending.back();
+                pending.pop_back();
+                while (fits(addr) && !(byte_flags[addr] & BYTE_ENTRY)){
+                    if (addr >= code_end){
+                        addExit(addr);
+                        break;
+                    }
+                    const DecodedInstr in = decodeAt(addr);
+                    const unsigned int size = instrSize(in.op);
+                    byte_flags[addr] |= BYTE_ENTRY;
+                    if (addr > 0 && (byte_flags[addr - 1] & BYTE_ENTRY)){
+                        overlapping.push_back(static_cast<uint16_t>(addr - 1));
+                    }
+                    if (addr + 1 < MEMORY_SIZE && (byte_flags[addr + 1] & BYTE_ENTRY)){
+                        overlapping.push_back(static_cast<uint16_t>(addr));
+                    }
+                    for (size_t b = addr; b < addr + size && b < MEMORY_SIZE; ++b){
+                        byte_flags[b] |= BYTE_CODE;
+                    }
+                    ++instruction_count;
+
+                    if (in.op == OP_JP){
+                        addLeader(in.nnn);
+                    } else if (in.op == OP_CALL){
+                        if (call_counts[in.nnn]++ == 0){
+                            call_targets.push_back(in.nnn);
+                        }
+                        addLeader(in.nnn);
+                        addLeader(addr + 2);
+                    } else if (in.op == OP_JP_V0){
+                        indirect_jumps.push_back(static_cast<uint16_t>(addr));
+                    } else if (isSkip(in.op)){
+                        addLeader(addr + 2);
+                        addLeader(skipTarget(addr));
+                    } else if (endsBlock(in.op)){
+                        if (in.op != OP_RET && in.op != OP_EXIT){
+                            addLeader(addr + size); // FX0A, escritas e F000 NNNN seguem adiante
+                        }
+                    } else {
+                        addr += size;
+                        continue;
+                    }
+                    break;
+                }
+            }
+        }
+
+        void cutBlocks(){
+            std::sort(leaders.begin(), leaders.end());
+            for (size_t start : leaders){
+                CodeBlock block = CodeBlock();
+                block.addr = static_cast<uint16_t>(start);
+                size_t addr = start;
+                DecodedInstr in;
+                for (;;){
+                    in = decodeAt(addr);
+                    ++block.instructions;
+                    size_t next = addr + instrSize(in.op);
+                    if (endsBlock(in.op) || !inProgram(next) || (byte_flags[next] & BYTE_LEADER)){
+                        break;
+                    }
+                    addr = next;
+                }
+                block.end = static_cast<uint32_t>(addr + instrSize(in.op));
+                block.last_op = in.op;
+
+                auto addSucc = [&](size_t target){
+                    if (fits(target)){
+                        block.succ[block.succ_count++] = static_cast<uint32_t>(target);
+                    }
+                };
+                if (in.op == OP_JP){
+                    addSucc(in.nnn);
+                } else if (in.op == OP_CALL){
+                    block.calls = true;
+                    block.call_target = in.nnn;
+                    addSucc(addr + 2);
+                } else if (isSkip(in.op)){
+                    addSucc(addr + 2);
+                    addSucc(skipTarget(addr));
+                } else if (in.op != OP_RET && in.op != OP_EXIT && in.op != OP_JP_V0){
+                    addSucc(block.end);
+                }
+
+                block_index[start] = static_cast<int32_t>(code_blocks.size());
+                code_blocks.push_back(block);
+            }
+        }
+
+        void trackI(){
+            for (const CodeBlock& block : code_blocks){
+                int32_t known_i = -1;
+                for (size_t addr = block.addr; addr < block.end; ){
+                    const DecodedInstr in = decodeAt(addr);
+                    if (in.op == OP_LD_I || in.op == OP_LD_I_LONG){
+                        known_i = in.op == OP_LD_I ? in.nnn : longOperand(addr);
+                        byte_flags[known_i] |= BYTE_DATA_REF;
+                        data_refs.push_back(DataRef{static_cast<uint16_t>(addr), static_cast<uint16_t>(known_i), isCode(known_i)});
+                    } else if (in.op == OP_ADD_I_VX || in.op == OP_LD_F_VX || in.op == OP_LD_HF_VX){
+                        known_i = -1;
+                    } else if (isStore(in.op)){
+                        StoreSite site{static_cast<uint16_t>(addr), in.op, known_i, storeLength(in), false};
+                        if (known_i >= 0){
+                            for (size_t b = known_i; b < static_cast<size_t>(known_i) + site.length && b < MEMORY_SIZE; ++b){
+                                site.hits_code = site.hits_code || isCode(b);
+                                byte_flags[b] |= BYTE_WRITTEN;
+                            }
+                        }
+                        store_sites.push_back(site);
+                    }
+                    addr += instrSize(in.op);
+                }
+            }
+        }
+
+        static uint16_t storeLength(const DecodedInstr& in){
+            if (in.op == OP_LD_B_VX){
+                return 3;
+            }
+            if (in.op == OP_SAVE_RANGE){
+                return static_cast<uint16_t>((in.x > in.y ? in.x - in.y : in.y - in.x) + 1);
+            }
+            return static_cast<uint16_t>(in.x + 1);
+        }
+
+        void findSubroutines(){
+            std::sort(call_targets.begin(), call_targets.end());
+            seen.assign(code_blocks.size(), 0);
+            std::vector<uint32_t> stack;
+            uint32_t mark = 0;
+            for (size_t entry : call_targets){
+                if (block_index[entry] < 0){
+                    continue;
+                }
+                Subroutine routine{static_cast<uint16_t>(entry), call_counts[entry], false, {}};
+                ++mark;
+                stack.assign(1, static_cast<uint32_t>(block_index[entry]));
+                seen[stack[0]] = mark;
+                while (!stack.empty()){
+                    uint32_t index = stack.back();
+                    stack.pop_back();
+                    routine.blocks.push_back(index);
+                    const CodeBlock& block = code_blocks[index];
+                    routine.returns = routine.returns || block.last_op == OP_RET;
+                    for (unsigned int s = 0; s < block.succ_count; ++s){
+                        int32_t next = block_index[block.succ[s]];
+                        if (next >= 0 && seen[next] != mark){
+                            seen[next] = mark;
+                            stack.push_back(static_cast<uint32_t>(next));
+                        }
+                    }
+                }
+                std::sort(routine.blocks.begin(), routine.blocks.end());
+                routines.push_back(routine);
+            }
+        }
+
+        void findOverlaps(){
+            std::sort(overlapping.begin(), overlapping.end());
+            std::sort(exit_targets.begin(), exit_targets.end());
+        }
+};
+
+
+#endif // ANALYSIS_H
@@ -0,0 +1,130 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <cstdint>
+#include <cmath>
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include "spsc_ring.h"
+
+
+// mudanca do som em um instante do tempo emulado (em ciclos da CPU)
+struct AudioEvent {
+    uint64_t cycle;
+    uint8_t beeping;      // sound timer > 0
+    uint8_t use_pattern;  // XO-CHIP: toca pattern em vez do tom fixo
+    uint8_t pitch;        // XO-CHIP: FX3A
+    std::array<uint8_t, 16> pattern;
+};
+
+
+// sintetizador do beep: o emulador empurra eventos carimbados com o ciclo emulado,
+// o callback de audio os aplica na amostra exata, sem lock entre as threads.
+// A latencia fica limitada a um buffer de audio: cada callback toca a janela
+// [agora - buffer, agora) do tempo emulado publicado pelo emulador.
+class AudioSynth {
+    public:
+        static const unsigned int WAVETABLE_SIZE = 128; // um bit do padrao XO-CHIP por entrada
+
+        AudioSynth(int sample_rate, double cpu_hz, int buffer_samples, double tone_hz, int16_t amplitude)
+            : cycles_per_sample(cpu_hz / sample_rate), buffer_cycles(buffer_samples * cpu_hz / sample_rate),
+              amplitude(amplitude), tone_step(phaseStep(tone_hz, sample_rate)) {
+            // tudo que usa pow ou percorre a tabela fica aqui, fora do callback de audio
+            for (unsigned int i = 0; i < WAVETABLE_SIZE; ++i){
+                square_table[i] = i < WAVETABLE_SIZE / 2 ? amplitude : -amplitude; // meia alta, meia baixa
+            }
+            for (unsigned int pitch = 0; pitch < pattern_steps.size(); ++pitch){
+                // XO-CHIP: 4000 * 2^((pitch - 64) / 48) bits por segundo, 128 bits por periodo
+                pattern_steps[pitch] = phaseStep(4000.0 * std::pow(2.0, (static_cast<int>(pitch) - 64) / 48.0) / WAVETABLE_SIZE, sample_rate);
+            }
+            AudioEvent silence = {};
+            apply(silence);
+        }
+
+        // ---- thread do emulador ----
+
+        // false se a fila estiver cheia; tente de novo depois
+        bool push(const AudioEvent& event){
+            return events.push(event);
+        }
+
+        // tempo emulado atual, chamado depois de cada lote de ciclos
+        void publish(uint64_t cycle){
+            now.store(cycle, std::memory_order_release);
+        }
+
+        // ---- thread de audio ----
+
+        void render(int16_t* out, int count){
+            double end = static_cast<double>(now.load(std::memory_order_acquire));
+            double start = std::min(std::max(clock, end - buffer_cycles), end);
+
+            for (int i = 0; i < count; ++i){
+                double sample_cycle = start + i * cycles_per_sample;
+                AudioEvent event;
+                while (events.peek(event) && event.cycle <= sample_cycle){
+                    events.pop(&event, 1);
+                    apply(event);
+                }
+
+                if (beeping){
+                    out[i] = wavetable[phase >> PHASE_SHIFT];
+                    phase += phase_step;
+                } else {
+                    out[i] = 0;
+                }
+            }
+            clock = start + count * cycles_per_sample;
+        }
+
+    private:
+        static const unsigned int PHASE_SHIFT = 25; // 7 bits de indice no topo de 32
+
+        double cycles_per_sample;
+        double buffer_cycles;
+        int16_t amplitude;
+        uint32_t tone_step;
+        std::array<uint32_t, 256> pattern_steps; // passo de fase por valor de FX3A
+        std::array<int16_t, WAVETABLE_SIZE> square_table;
+
+        SpscRing<AudioEvent, 256> events;
+        alignas(64) std::atomic<uint64_t> now{0};
+
+        // estado do lado do audio
+        double clock = 0.0;
+        bool beeping = false;
+        uint32_t phase = 0;
+        uint32_t phase_step = 0;
+        const int16_t* wavetable = nullptr;
+        std::array<int16_t, WAVETABLE_SIZE> pattern_table;
+        std::array<uint8_t, 16> loaded_pattern;
+        bool pattern_loaded = false;
+
+        static uint32_t phaseStep(double periods_per_second, int sample_rate){
+            return static_cast<uint32_t>(periods_per_second / sample_rate * 4294967296.0);
+        }
+
+        void apply(const AudioEvent& event){
+            beeping = event.beeping != 0;
+            if (event.use_pattern){
+                // o padrao so e expandido quando muda (F002); o tom sai da tabela de passos
+                if (!pattern_loaded || event.pattern != loaded_pattern){
+                    for (unsigned int bit = 0; bit < WAVETABLE_SIZE; ++bit){
+                        bool high = (event.pattern[bit / 8] >> (7 - bit % 8)) & 1;
+                        pattern_table[bit] = high ? amplitude : -amplitude;
+                    }
+                    loaded_pattern = event.pattern;
+                    pattern_loaded = true;
+                }
+                wavetable = pattern_table.data();
+                phase_step = pattern_steps[event.pitch];
+            } else {
+                wavetable = square_table.data();
+                phase_step = tone_step;
+            }
+        }
+};
+
+
+#endif // AUDIO_H
@@ -0,0 +1,568 @@
+// chip8-batch: executa muitas sessoes de ROM em paralelo, sem SDL
+//
+// uso:
+//   chip8-batch [--threads N] [--cycles N] [--engine interp|block|lockstep] [--seed N] rom1.ch8 rom2.ch8 ...
+//   chip8-batch [--threads N] [--cycles N] [--engine interp|block|lockstep] [--seed N] --manifest lista.txt
+//   chip8-batch [--threads N] [--cycles N] [--engine interp|block|lockstep] [--seed N] --rom-dir diretorio
+//   chip8-batch [--cycles N] [--engine interp|block|lockstep] --movie filme.c8mv rom.ch8
+//   chip8-batch-profile --profile prefixo ...   (make profile; relatorio por job)
+//
+// manifesto: uma sessao por linha, "rom [ciclos] [entrada]", '#' comenta
+// entrada: script de texto, uma transicao por linha "<ciclo> <tecla hex> down|up",
+// ou um filme gravado pelo frontend (--record), lido do disco aos poucos
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "chip8.h"
+#include "chip8_batch.h"
+#include "hash.h"
+#include "movie.h"
+#include "rom_library.h"
+#include "thread_pool.h"
+
+
+const uint64_t DEFAULT_CYCLE_BUDGET = 1000000;
+const unsigned int BATCH_CPU_HZ = 700; // mesma velocidade do frontend
+const size_t LOCKSTEP_LANES = 256;      // jobs por Chip8Batch em --engine lockstep
+const uint64_t MAX_THREADS = 1024;      // --threads acima disso e engano, nao pedido
+
+
+struct InputEvent {
+    uint64_t cycle;
+    uint8_t key;
+    bool pressed;
+};
+
+struct Job {
+    std::string rom_path;
+    uint64_t cycle_budget;
+    std::string input_path;
+    bool input_is_movie = false; // filme: cada job abre o seu e le em streaming
+    std::string profile_path;    // vazio = sem profiler (so com CHIP8_PROFILE)
+
+    // preenchidos na preparacao (compartilhados entre jobs da mesma ROM)
+    const RomLibrary<Chip8>::Entry* rom = nullptr;
+    std::shared_ptr<const std::vector<InputEvent>> input;
+};
+
+struct JobResult {
+    uint64_t cycles = 0;
+    uint64_t framebuffer_hash = 0;
+    double wall_seconds = 0.0;
+    std::string status = "ok";
+    std::array<uint64_t, FAULT_KINDS> fault_counts = {};
+};
+
+
+static bool readInputScript(const std::string& path, std::vector<InputEvent>& out){
+    std::ifstream file(path);
+    if (!file.is_open()){
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)){
+        if (line.empty() || line[0] == '#'){
+            continue;
+        }
+        std::istringstream fields(line);
+        InputEvent ev;
+        unsigned int key;
+        std::string action;
+        if (!(fields >> ev.cycle >> std::hex >> key >> action) || key > 0xF || (action != "down" && action != "up")){
+            std::cerr << "Erro: linha invalida no script " << path << ": " << line << std::endl;
+            return false;
+        }
+        ev.key = static_cast<uint8_t>(key);
+        ev.pressed = (action == "down");
+        out.push_back(ev);
+    }
+
+    std::stable_sort(out.begin(), out.end(), [](const InputEvent& a, const InputEvent& b){ return a.cycle < b.cycle; });
+    return true;
+}
+
+// so digitos e cabendo em 64 bits: "rom.ch8 script.txt" (ciclos esquecidos) ou "--cycles 1e6"
+// e erro, nao excecao
+static bool parseCount(const std::string& text, uint64_t& value){
+    std::istringstream number(text);
+    return !text.empty() && text.find_first_not_of("0123456789") == std::string::npos && (number >> value);
+}
+
+static bool readManifest(const std::string& path, uint64_t default_budget, std::vector<Job>& jobs){
+    std::ifstream file(path);
+    if (!file.is_open()){
+        std::cerr << "Erro: nao foi possivel abrir o manifesto: " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)){
+        std::istringstream fields(line);
+        Job job;
+        if (!(fields >> job.rom_path) || job.rom_path[0] == '#'){
+            continue;
+        }
+        job.cycle_budget = default_budget;
+        std::string budget;
+        if (fields >> budget){
+            if (!parseCount(budget, job.cycle_budget)){
+                std::cerr << "Erro: linha invalida no manifesto " << path << ": " << line << std::endl;
+                return false;
+            }
+            fields >> job.input_path;
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+
+static bool isMovie(const std::string& path){
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(MOVIE_MAGIC)] = {};
+    file.read(magic, sizeof(magic));
+    return file && std::memcmp(magic, MOVIE_MAGIC, sizeof(MOVIE_MAGIC)) == 0;
+}
+
+
+// proxima transicao do script (compartilhado, em memoria) ou do filme (streaming)
+class InputSource {
+    public:
+        InputSource(const std::vector<InputEvent>* script, MoviePlayer* movie): script(script), movie(movie), next_index(0) {}
+
+        bool peek(InputEvent& out) const {
+            if (movie){
+                MovieEvent ev;
+                if (!movie->peek(ev)){
+                    return false;
+                }
+                out.cycle = ev.cycle;
+                out.key = ev.key;
+                out.pressed = ev.pressed;
+                return true;
+            }
+            if (script && next_index < script->size()){
+                out = (*script)[next_index];
+                return true;
+            }
+            return false;
+        }
+
+        void pop(){
+            if (movie){
+                movie->pop();
+            } else {
+                ++next_index;
+            }
+        }
+
+    private:
+        const std::vector<InputEvent>* script;
+        MoviePlayer* movie;
+        size_t next_index;
+};
+
+
+// filme: semente, velocidade e ROM vem do cabecalho gravado; false com o status do job
+static bool openMovie(const Job& job, MoviePlayer& movie, uint64_t& seed, unsigned int& cpu_hz, std::string& status){
+    if (!movie.open(job.input_path)){
+        status = "fault: filme invalido";
+        return false;
+    }
+    const MovieHeader& header = movie.getHeader();
+    if (header.variant != ClassicChip8::ID || header.rng != Chip8::RngType::ID || header.cpu_hz == 0){
+        status = "fault: filme de outra variante ou gerador";
+        return false;
+    }
+    if (header.rom_hash != job.rom->hash){
+        status = "fault: filme gravado com outra ROM";
+        return false;
+    }
+    seed = header.seed;
+    cpu_hz = header.cpu_hz;
+    return true;
+}
+
+
+static JobResult runJob(const Job& job, ExecEngine engine, uint64_t seed){
+    using Clock = std::chrono::steady_clock;
+    JobResult result;
+    Clock::time_point start = Clock::now();
+
+    MoviePlayer movie;
+    unsigned int cpu_hz = BATCH_CPU_HZ;
+    if (job.input_is_movie && !openMovie(job, movie, seed, cpu_hz, result.status)){
+        return result;
+    }
+
+    Chip8 chip8_instance;
+    chip8_instance.seedRandom(seed); // mesma semente => mesma execucao, bit a bit
+    chip8_instance.loadProgram(*job.rom->image); // imagem ja validada e pre-decodificada
+
+#ifdef CHIP8_PROFILE
+    std::unique_ptr<Profiler> profiler;
+    if (!job.profile_path.empty()){
+        profiler.reset(new Profiler(Chip8::MEMORY_SIZE));
+        chip8_instance.profiler = profiler.get();
+    }
+#endif
+
+    InputSource input(job.input.get(), job.input_is_movie ? &movie : nullptr);
+    InputEvent ev;
+    chip8_instance.setCpuHz(cpu_hz);
+
+    while (chip8_instance.cycleCount() < job.cycle_budget){
+        uint64_t c = chip8_instance.cycleCount();
+        while (input.peek(ev) && ev.cycle <= c){
+            input.pop();
+            if (ev.pressed){
+                chip8_instance.setKeyPressed(ev.key);
+                chip8_instance.handleKeyPressEvent(ev.key);
+            } else {
+                chip8_instance.setKeyReleased(ev.key);
+            }
+        }
+
+        // roda ate o proximo evento de entrada; os ticks de timer (60 Hz em tempo
+        // emulado) ficam com runFor(), e em espera de tecla o tempo passa sem executar
+        uint64_t stop = job.cycle_budget;
+        if (input.peek(ev)){
+            stop = std::min(stop, ev.cycle);
+        }
+
+        RunResult run = chip8_instance.runFor(stop - c, engine);
+        result.cycles = chip8_instance.cycleCount(); // na falha, o ciclo exato dela
+        if (run.fault != Fault::None){
+            char where[16];
+            std::snprintf(where, sizeof(where), " @%03X", chip8_instance.fault_pc);
+            result.status = std::string("fault: ") + faultName(run.fault) + where;
+            break;
+        }
+    }
+
+#ifdef CHIP8_PROFILE
+    if (profiler && !profiler->writeFiles(job.profile_path, opKindName)){
+        std::cerr << "Erro: nao foi possivel gravar o relatorio do profiler: " << job.profile_path << std::endl;
+    }
+#endif
+
+    result.fault_counts = chip8_instance.fault_counts;
+    result.framebuffer_hash = fnv1a64(chip8_instance.display_buffer.data(), sizeof(chip8_instance.display_buffer));
+    result.wall_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return result;
+}
+
+
+// motor lockstep: os jobs de lanes como pistas de um Chip8Batch. Mesmo laco de
+// runJob (entrada, tick de 60 Hz, orcamento), com um run() para todas as pistas a
+// cada volta; cada uma para no proprio tick ou evento. Os resultados sao os mesmos
+// de --engine interp; o tempo de parede do grupo e dividido entre os jobs.
+static void runLockstep(const std::vector<Job>& jobs, const std::vector<size_t>& lanes, uint64_t seed, std::vector<JobResult>& results){
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+
+    const size_t count = lanes.size();
+    std::unique_ptr<Chip8Batch> batch(new Chip8Batch(count));
+    std::vector<std::unique_ptr<MoviePlayer>> movies(count);
+    std::vector<InputSource> inputs;
+    std::vector<unsigned int> cpu_hz(count, BATCH_CPU_HZ);
+    std::vector<uint64_t> frames(count, 0);
+    std::vector<uint64_t> next_tick(count, 0);
+    std::vector<uint64_t> cycles(count, 0);
+    std::vector<uint64_t> stops(count, 0);
+    std::vector<uint64_t> budgets(count, 0);
+    std::vector<bool> running(count, true);
+    std::vector<bool> loaded(count, true); // falso se o filme nao abriu
+    size_t active = count;
+
+    inputs.reserve(count);
+    for (size_t l = 0; l < count; ++l){
+        const Job& job = jobs[lanes[l]];
+        uint64_t lane_seed = seed;
+        if (job.input_is_movie){
+            movies[l].reset(new MoviePlayer());
+            if (!openMovie(job, *movies[l], lane_seed, cpu_hz[l], results[lanes[l]].status)){
+                running[l] = false;
+                loaded[l] = false;
+                --active;
+            }
+        }
+        inputs.push_back(InputSource(job.input.get(), movies[l].get()));
+        batch->seedRandom(l, lane_seed);
+        batch->loadProgram(l, *job.rom->image);
+        next_tick[l] = timerTickCycle(1, cpu_hz[l]);
+    }
+
+    while (active > 0){
+        for (size_t l = 0; l < count; ++l){
+            budgets[l] = 0;
+            if (!running[l]){
+                continue;
+            }
+            InputEvent ev;
+            while (inputs[l].peek(ev) && ev.cycle <= cycles[l]){
+                inputs[l].pop();
+                if (ev.pressed){
+                    batch->setKeyPressed(l, ev.key);
+                    batch->handleKeyPressEvent(l, ev.key);
+                } else {
+                    batch->setKeyReleased(l, ev.key);
+                }
+            }
+            stops[l] = std::min(next_tick[l], jobs[lanes[l]].cycle_budget);
+            if (inputs[l].peek(ev)){
+                stops[l] = std::min(stops[l], ev.cycle);
+            }
+            budgets[l] = stops[l] - cycles[l];
+        }
+
+        batch->run(budgets.data());
+
+        for (size_t l = 0; l < count; ++l){
+            if (!running[l]){
+                continue;
+            }
+            JobResult& result = results[lanes[l]];
+            Fault fault = batch->getFault(l);
+            if (fault != Fault::None){
+                char where[16];
+                std::snprintf(where, sizeof(where), " @%03X", batch->lane(l).fault_pc);
+                result.status = std::string("fault: ") + faultName(fault) + where;
+                result.cycles = cycles[l] + batch->lastExecuted(l);
+                running[l] = false;
+                --active;
+                continue;
+            }
+            cycles[l] = stops[l];
+            result.cycles = cycles[l];
+            if (cycles[l] == next_tick[l]){
+                ++frames[l];
+                next_tick[l] = timerTickCycle(frames[l] + 1, cpu_hz[l]);
+                batch->updateTimers(l);
+            }
+            if (cycles[l] >= jobs[lanes[l]].cycle_budget){
+                running[l] = false;
+                --active;
+            }
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (size_t l = 0; l < count; ++l){
+        if (!loaded[l]){
+            continue;
+        }
+        const Chip8& lane = batch->lane(l);
+        JobResult& result = results[lanes[l]];
+        result.fault_counts = lane.fault_counts;
+        result.framebuffer_hash = fnv1a64(lane.display_buffer.data(), sizeof(lane.display_buffer));
+        result.wall_seconds = seconds / count;
+    }
+}
+
+
+static void printUsage(const char* program){
+    std::cerr << "Uso: " << program << " [--threads N] [--cycles N] [--engine interp|block|lockstep] [--seed N] (--manifest lista.txt | --rom-dir diretorio | rom.ch8 ...)" << std::endl;
+}
+
+// semente como em --seed do frontend: decimal, 0x... ou 0..., o texto todo
+static bool parseSeed(const std::string& text, uint64_t& seed){
+    if (text.empty() || !std::isdigit(static_cast<unsigned char>(text[0]))){
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long parsed = std::strtoull(text.c_str(), &end, 0);
+    if (*end != '\0' || errno == ERANGE){
+        return false;
+    }
+    seed = parsed;
+    return true;
+}
+
+
+int main(int argc, char* argv[]){
+    unsigned int num_threads = 0;
+    uint64_t default_budget = DEFAULT_CYCLE_BUDGET;
+    ExecEngine engine = ExecEngine::Block;
+    bool lockstep = false;
+    uint64_t seed = DEFAULT_RANDOM_SEED;
+    std::vector<Job> jobs;
+    std::vector<std::string> rom_dirs;
+    std::string movie_path;
+    std::string profile_prefix;
+
+    for (int i = 1; i < argc; ++i){
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc){
+            uint64_t threads = 0;
+            if (!parseCount(argv[++i], threads) || threads > MAX_THREADS){
+                std::cerr << "Numero de threads invalido: " << argv[i] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+            num_threads = static_cast<unsigned int>(threads);
+        } else if (arg == "--cycles" && i + 1 < argc){
+            if (!parseCount(argv[++i], default_budget)){
+                std::cerr << "Numero de ciclos invalido: " << argv[i] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--engine" && i + 1 < argc){
+            std::string name = argv[++i];
+            if (name != "interp" && name != "block" && name != "lockstep"){
+                std::cerr << "Motor desconhecido: " << name << " (use interp, block ou lockstep)" << std::endl;
+                return 1;
+            }
+            engine = (name == "block") ? ExecEngine::Block : ExecEngine::Interpreter;
+            lockstep = (name == "lockstep");
+        } else if (arg == "--seed" && i + 1 < argc){
+            if (!parseSeed(argv[++i], seed)){
+                std::cerr << "Semente invalida: " << argv[i] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--movie" && i + 1 < argc){
+            movie_path = argv[++i];
+        } else if (arg == "--profile" && i + 1 < argc){
+            profile_prefix = argv[++i];
+        } else if (arg == "--rom-dir" && i + 1 < argc){
+            rom_dirs.push_back(argv[++i]);
+        } else if (arg == "--manifest" && i + 1 < argc){
+            if (!readManifest(argv[++i], default_budget, jobs)){
+                return 1;
+            }
+        } else if (!arg.empty() && arg[0] == '-'){
+            std::cerr << "Argumento desconhecido: " << arg << std::endl;
+            return 1;
+        } else {
+            Job job;
+            job.rom_path = arg;
+            job.cycle_budget = default_budget;
+            jobs.push_back(job);
+        }
+    }
+
+    // cada ROM e mapeada uma unica vez; conteudo repetido vira a mesma entrada
+    RomLibrary<Chip8> library;
+    for (const std::string& dir : rom_dirs){
+        size_t first = library.entries().size();
+        library.addDirectory(dir);
+        for (size_t i = first; i < library.entries().size(); ++i){
+            Job job;
+            job.rom_path = library.entries()[i]->path;
+            job.cycle_budget = default_budget;
+            jobs.push_back(job);
+        }
+    }
+
+#ifndef CHIP8_PROFILE
+    if (!profile_prefix.empty()){
+        std::cerr << "Profiler indisponivel: recompile com 'make profile' (CHIP8_PROFILE)." << std::endl;
+        return 1;
+    }
+#endif
+    if (!profile_prefix.empty() && lockstep){
+        std::cerr << "O profiler precisa do motor interp ou block." << std::endl;
+        return 1;
+    }
+
+    if (jobs.empty()){
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // scripts de entrada tambem sao lidos uma unica vez
+    std::map<std::string, std::shared_ptr<const std::vector<InputEvent>>> inputs;
+    for (size_t i = 0; i < jobs.size(); ++i){
+        Job& job = jobs[i];
+        job.rom = library.add(job.rom_path);
+        if (!job.rom){
+            return 1;
+        }
+        if (!profile_prefix.empty()){
+            job.profile_path = profile_prefix + std::to_string(i) + "-" + job.rom->name + ".txt";
+        }
+        if (job.input_path.empty()){
+            job.input_path = movie_path;
+        }
+        if (!job.input_path.empty() && isMovie(job.input_path)){
+            job.input_is_movie = true;
+            continue;
+        }
+
+        if (!job.input_path.empty()){
+            std::shared_ptr<const std::vector<InputEvent>>& input = inputs[job.input_path];
+            if (!input){
+                std::shared_ptr<std::vector<InputEvent>> events = std::make_shared<std::vector<InputEvent>>();
+                if (!readInputScript(job.input_path, *events)){
+                    return 1;
+                }
+                input = events;
+            }
+            job.input = input;
+        }
+    }
+
+    std::vector<JobResult> results(jobs.size());
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    unsigned int pool_size;
+    {
+        WorkStealingPool pool(num_threads);
+        pool_size = pool.size();
+        if (lockstep){
+            // jobs da mesma ROM no mesmo lote: pistas com o mesmo codigo andam juntas
+            std::vector<size_t> order(jobs.size());
+            for (size_t i = 0; i < order.size(); ++i){
+                order[i] = i;
+            }
+            std::stable_sort(order.begin(), order.end(), [&jobs](size_t a, size_t b){ return jobs[a].rom->hash < jobs[b].rom->hash; });
+            for (size_t i = 0; i < order.size(); i += LOCKSTEP_LANES){
+                std::vector<size_t> lanes(order.begin() + i, order.begin() + std::min(order.size(), i + LOCKSTEP_LANES));
+                pool.submit([&jobs, &results, lanes, seed]{ runLockstep(jobs, lanes, seed, results); });
+            }
+        } else {
+            for (size_t i = 0; i < jobs.size(); ++i){
+                pool.submit([&jobs, &results, i, engine, seed]{ results[i] = runJob(jobs[i], engine, seed); });
+            }
+        }
+        pool.wait();
+    }
+    double total_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t total_cycles = 0;
+    std::array<uint64_t, FAULT_KINDS> total_faults = {};
+    std::printf("job\trom\tcycles\tframebuffer_hash\twall_us\tstatus\n");
+    for (size_t i = 0; i < jobs.size(); ++i){
+        const JobResult& r = results[i];
+        total_cycles += r.cycles;
+        for (size_t kind = 1; kind < FAULT_KINDS; ++kind){
+            total_faults[kind] += r.fault_counts[kind];
+        }
+        std::printf("%zu\t%s\t%llu\t%016llx\t%.0f\t%s\n", i, jobs[i].rom_path.c_str(),
+            static_cast<unsigned long long>(r.cycles), static_cast<unsigned long long>(r.framebuffer_hash),
+            r.wall_seconds * 1e6, r.status.c_str());
+    }
+
+    std::fprintf(stderr, "%zu jobs, %u threads, %llu ciclos em %.3f s (%.1f MIPS)\n", jobs.size(), pool_size,
+        static_cast<unsigned long long>(total_cycles), total_seconds, total_cycles / total_seconds / 1e6);
+    for (size_t kind = 1; kind < FAULT_KINDS; ++kind){
+        if (total_faults[kind] > 0){
+            std::fprintf(stderr, "  %-22s %llu\n", faultName(static_cast<Fault>(kind)), static_cast<unsigned long long>(total_faults[kind]));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,345 @@
+// chip8-bench: suite de benchmarks do nucleo
+//
+// uso: chip8-bench [--cycles N] [--out resultados.tsv] [--baseline anterior.tsv] [--tolerance PCT] [rom.ch8 ...]
+//
+// mede instrucoes/s por familia de opcode e por ROM inteira (ROMs embutidas
+// + as passadas na linha de comando) nos dois motores, e o custo de conversao
+// do framebuffer, conferindo o estado final entre os motores e contra a execucao
+// passo a passo (sem salto de laco ocioso). Saida em TSV "nome<TAB>valor<TAB>unidade"; com --baseline
+// compara com uma execucao anterior e sai com 2 se algo piorou alem da tolerancia.
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "chip8.h"
+#include "bench_roms.h"
+#include "chip8_batch.h"
+#include "fork.h"
+#include "hash.h"
+#include "render.h"
+
+
+const uint64_t DEFAULT_BENCH_CYCLES = 20000000;
+const unsigned int BENCH_CPU_HZ = 700; // mesma velocidade do frontend e do batch
+const unsigned int BENCH_SEED = 0xC8;
+const unsigned int BENCH_FRAME_ITERATIONS = 200000;
+const size_t BENCH_LOCKSTEP_LANES = 256;
+const uint64_t BENCH_IDLE_CHECK_CYCLES = 200000;
+const double DEFAULT_TOLERANCE_PCT = 10.0;
+
+
+struct EngineRun {
+    double seconds = 0.0;
+    uint64_t executed = 0; // o que de fato rodou (RunResult::executed), base do MIPS
+    uint64_t state_hash = 0;
+    std::string status = "ok";
+};
+
+struct Result {
+    std::string name;
+    double value;
+    std::string unit;
+};
+
+static uint64_t stateHash(const Chip8& c){
+    uint64_t hash = fnv1a64(c.memory.data(), c.memory.size());
+    hash = fnv1a64(c.V.data(), c.V.size(), hash);
+    hash = fnv1a64(c.display_buffer.data(), sizeof(c.display_buffer), hash);
+    uint16_t regs[3] = {c.I, c.pc, c.sp};
+    return fnv1a64(regs, sizeof(regs), hash);
+}
+
+// cycles de tempo emulado com o relogio do nucleo (runFor: ticks em timerTickCycle, como
+// no frontend e no batch)
+static EngineRun runEngine(const std::vector<uint8_t>& rom, uint64_t cycles, ExecEngine engine, uint64_t seed = BENCH_SEED){
+    EngineRun result;
+    Chip8 chip8_instance;
+    chip8_instance.setCpuHz(BENCH_CPU_HZ);
+    chip8_instance.seedRandom(seed);
+    chip8_instance.loadRomData(rom.data(), rom.size());
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    RunResult run = chip8_instance.runFor(cycles, engine);
+    result.executed = run.executed;
+    if (run.fault != Fault::None){
+        result.status = std::string("fault: ") + faultName(run.fault);
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.state_hash = stateHash(chip8_instance);
+    return result;
+}
+
+// Chip8Batch: a ROM em todas as pistas, uma semente por pista (BENCH_SEED + pista), o
+// mesmo tempo emulado dividido entre elas, com os ticks nos mesmos ciclos de runFor();
+// lanes recebe o estado final de cada pista
+static EngineRun runLockstep(const std::vector<uint8_t>& rom, uint64_t lane_cycles, std::vector<EngineRun>& lanes){
+    EngineRun result;
+    Chip8 image;
+    image.loadRomData(rom.data(), rom.size());
+    image.predecodeProgram(rom.size());
+    std::unique_ptr<Chip8Batch> batch(new Chip8Batch(BENCH_LOCKSTEP_LANES));
+    for (size_t lane = 0; lane < batch->size(); ++lane){
+        batch->loadProgram(lane, image);
+        batch->seedRandom(lane, BENCH_SEED + lane);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t done = 0;
+    for (uint64_t frame = 1; done < lane_cycles; ++frame){
+        uint64_t tick = timerTickCycle(frame, BENCH_CPU_HZ);
+        uint64_t stop = tick < lane_cycles ? tick : lane_cycles;
+        result.executed += batch->run(stop - done);
+        done = stop;
+        if (done == tick){
+            batch->updateTimers();
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    lanes.assign(batch->size(), EngineRun());
+    for (size_t lane = 0; lane < batch->size(); ++lane){
+        const Chip8& c = batch->lane(lane);
+        lanes[lane].state_hash = stateHash(c);
+        if (c.fault != Fault::None){
+            lanes[lane].status = std::string("fault: ") + faultName(c.fault);
+        }
+    }
+    return result;
+}
+
+// pular lacos ociosos tem que dar o mesmo que executar uma instrucao por vez: em
+// runFor(1) nao cabe uma volta inteira (so a do JP para si mesmo, que nao muda nada)
+static bool idleExact(const std::string& prefix, const std::vector<uint8_t>& rom, ExecEngine engine){
+    Chip8 stepped;
+    Chip8 skipped;
+    for (Chip8* c : {&stepped, &skipped}){
+        c->setCpuHz(BENCH_CPU_HZ);
+        c->seedRandom(BENCH_SEED);
+        c->loadRomData(rom.data(), rom.size());
+    }
+    for (uint64_t n = 0; n < BENCH_IDLE_CHECK_CYCLES && stepped.fault == Fault::None; ++n){
+        stepped.runFor(1);
+    }
+    skipped.runFor(BENCH_IDLE_CHECK_CYCLES, engine);
+
+    if (stateHash(stepped) != stateHash(skipped) || stepped.cycleCount() != skipped.cycleCount()
+            || stepped.delay_timer != skipped.delay_timer || stepped.sound_timer != skipped.sound_timer
+            || stepped.fault != skipped.fault){
+        std::cerr << "ERRO: " << prefix << ": " << (engine == ExecEngine::Block ? "blocos" : "interpretador")
+                  << " com salto de laco ocioso difere da execucao passo a passo" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// roda nos motores escalares e no lockstep; false se o estado final divergir
+static bool benchRom(const std::string& prefix, const std::vector<uint8_t>& rom, uint64_t cycles, std::vector<Result>& results){
+    EngineRun interp = runEngine(rom, cycles, ExecEngine::Interpreter);
+    EngineRun block = runEngine(rom, cycles, ExecEngine::Block);
+
+    uint64_t lane_cycles = (cycles + BENCH_LOCKSTEP_LANES - 1) / BENCH_LOCKSTEP_LANES;
+    std::vector<EngineRun> lanes;
+    EngineRun lockstep = runLockstep(rom, lane_cycles, lanes);
+
+    results.push_back({prefix + ".interp", interp.executed / interp.seconds / 1e6, "MIPS"});
+    results.push_back({prefix + ".block", block.executed / block.seconds / 1e6, "MIPS"});
+    results.push_back({prefix + ".speedup", interp.seconds / block.seconds, "x"});
+    results.push_back({prefix + ".lockstep", lockstep.executed / lockstep.seconds / 1e6, "MIPS"});
+
+    if (interp.state_hash != block.state_hash || interp.status != block.status){
+        std::cerr << "ERRO: " << prefix << ": estado final difere entre os motores" << std::endl;
+        return false;
+    }
+    // cada pista contra o interpretador escalar com a mesma semente: as outras sementes
+    // divergem e passam pelos caminhos de pista desgarrada e de volta ao escalar
+    for (size_t lane = 0; lane < lanes.size(); ++lane){
+        EngineRun lane_ref = runEngine(rom, lane_cycles, ExecEngine::Interpreter, BENCH_SEED + lane);
+        if (lanes[lane].state_hash != lane_ref.state_hash || lanes[lane].status != lane_ref.status){
+            std::cerr << "ERRO: " << prefix << ": pista " << lane << " do lockstep difere do interpretador" << std::endl;
+            return false;
+        }
+    }
+    if (!idleExact(prefix, rom, ExecEngine::Interpreter) || !idleExact(prefix, rom, ExecEngine::Block)){
+        return false;
+    }
+    if (interp.status != "ok"){
+        std::cerr << "aviso: " << prefix << ": " << interp.status << std::endl;
+    }
+    return true;
+}
+
+template <typename Fn>
+static double nanosPerCall(unsigned int iterations, Fn fn){
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < iterations; ++i){
+        fn(i);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return seconds * 1e9 / iterations;
+}
+
+static void benchFramebuffer(std::vector<Result>& results){
+    Chip8 chip8_instance;
+    for (unsigned int i = 0; i < DISPLAY_SIZE / 3; ++i){
+        chip8_instance.setPixel((i * 37) % DISPLAY_WIDTH, (i * 11) % DISPLAY_HEIGHT, true);
+    }
+
+    const FramebufferExpander expander(FramebufferExpander::packColor(255, 97, 0), FramebufferExpander::packColor(0, 0, 0));
+    std::vector<uint32_t> pixels(DISPLAY_SIZE);
+    uint64_t sink = 0;
+
+    results.push_back({"framebuffer.expand", nanosPerCall(BENCH_FRAME_ITERATIONS, [&](unsigned int i){
+        chip8_instance.display_buffer[i % DISPLAY_HEIGHT] ^= i; // impede que o laco seja removido
+        expander.expand(chip8_instance, pixels.data(), DISPLAY_WIDTH * sizeof(uint32_t));
+        sink += pixels[i % DISPLAY_SIZE];
+    }), "ns/frame"});
+
+    results.push_back({"framebuffer.hash", nanosPerCall(BENCH_FRAME_ITERATIONS, [&](unsigned int){
+        sink += fnv1a64(chip8_instance.display_buffer.data(), sizeof(chip8_instance.display_buffer));
+    }), "ns/frame"});
+
+    std::vector<uint8_t> state;
+    results.push_back({"state.save", nanosPerCall(BENCH_FRAME_ITERATIONS / 10, [&](unsigned int){
+        chip8_instance.saveState(state);
+        sink += state.size();
+    }), "ns/op"});
+
+    // fork de um ramo que escreveu uma pagina (como FX33): so ela e copiada
+    ForkRunner<Chip8> runner;
+    runner.machine().display_buffer = chip8_instance.display_buffer;
+    MachineFork<Chip8> root = runner.fork();
+    results.push_back({"fork.capture", nanosPerCall(BENCH_FRAME_ITERATIONS / 10, [&](unsigned int i){
+        runner.load(root);
+        runner.machine().memory[0x300] = static_cast<uint8_t>(i);
+        runner.machine().invalidateDecoded(0x300, 1);
+        sink += runner.fork().peek(0x300);
+    }), "ns/op"});
+
+    MachineFork<Chip8> branch = runner.fork();
+    results.push_back({"fork.load", nanosPerCall(BENCH_FRAME_ITERATIONS / 10, [&](unsigned int i){
+        runner.load(i % 2 ? branch : root);
+        sink += runner.machine().pc;
+    }), "ns/op"});
+
+    if (sink == 42){
+        std::cerr << std::endl;
+    }
+}
+
+static bool readResults(const std::string& path, std::map<std::string, Result>& out){
+    std::ifstream file(path);
+    if (!file.is_open()){
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)){
+        std::istringstream fields(line);
+        Result r;
+        if (fields >> r.name >> r.value >> r.unit){
+            out[r.name] = r;
+        }
+    }
+    return true;
+}
+
+// unidades de tempo: menor e melhor; o resto (MIPS, x): maior e melhor
+static bool lowerIsBetter(const std::string& unit){
+    return unit.compare(0, 3, "ns/") == 0;
+}
+
+
+int main(int argc, char* argv[]){
+    uint64_t cycles = DEFAULT_BENCH_CYCLES;
+    double tolerance_pct = DEFAULT_TOLERANCE_PCT;
+    std::string out_path;
+    std::string baseline_path;
+    std::vector<std::string> rom_paths;
+
+    for (int i = 1; i < argc; ++i){
+        std::string arg = argv[i];
+        if (arg == "--cycles" && i + 1 < argc){
+            cycles = std::stoull(argv[++i]);
+        } else if (arg == "--out" && i + 1 < argc){
+            out_path = argv[++i];
+        } else if (arg == "--baseline" && i + 1 < argc){
+            baseline_path = argv[++i];
+        } else if (arg == "--tolerance" && i + 1 < argc){
+            tolerance_pct = std::stod(argv[++i]);
+        } else if (!arg.empty() && arg[0] == '-'){
+            std::cerr << "Uso: " << argv[0] << " [--cycles N] [--out resultados.tsv] [--baseline anterior.tsv] [--tolerance PCT] [rom.ch8 ...]" << std::endl;
+            return 1;
+        } else {
+            rom_paths.push_back(arg);
+        }
+    }
+
+    std::vector<Result> results;
+    bool all_match = true;
+
+    for (const BenchRom& rom : opcodeFamilyRoms()){
+        all_match = benchRom(std::string("op.") + rom.name, rom.data, cycles, results) && all_match;
+    }
+    for (const BenchRom& rom : bundledRoms()){
+        all_match = benchRom(std::string("rom.") + rom.name, rom.data, cycles, results) && all_match;
+    }
+    for (const std::string& path : rom_paths){
+        std::ifstream file(path, std::ios::binary);
+        std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (!file.is_open() || rom.size() > MEMORY_SIZE - START_ADDRESS){
+            std::cerr << "Erro: ROM invalida: " << path << std::endl;
+            return 1;
+        }
+        // nome sem diretorio nem extensao, sem espacos (o TSV separa por espaco em branco)
+        std::string name = path.substr(path.find_last_of("/\\") + 1);
+        name = name.substr(0, name.find_last_of('.'));
+        for (char& ch : name){
+            if (ch == ' ' || ch == '\t'){
+                ch = '_';
+            }
+        }
+        all_match = benchRom("file." + name, rom, cycles, results) && all_match;
+    }
+
+    benchFramebuffer(results);
+
+    std::ostringstream report;
+    for (const Result& r : results){
+        report << r.name << '\t' << r.value << '\t' << r.unit << '\n';
+    }
+    std::cout << report.str();
+    if (!out_path.empty()){
+        std::ofstream out(out_path);
+        out << report.str();
+    }
+
+    int regressions = 0;
+    if (!baseline_path.empty()){
+        std::map<std::string, Result> baseline;
+        if (!readResults(baseline_path, baseline)){
+            std::cerr << "Erro: nao foi possivel ler o baseline: " << baseline_path << std::endl;
+            return 1;
+        }
+        std::fprintf(stderr, "%-32s %12s %12s %8s\n", "benchmark", "baseline", "atual", "delta");
+        for (const Result& r : results){
+            std::map<std::string, Result>::const_iterator it = baseline.find(r.name);
+            if (it == baseline.end() || it->second.value == 0.0){
+                continue;
+            }
+            double delta_pct = (r.value - it->second.value) / it->second.value * 100.0;
+            double worse_pct = lowerIsBetter(r.unit) ? delta_pct : -delta_pct;
+            bool regressed = worse_pct > tolerance_pct;
+            regressions += regressed ? 1 : 0;
+            std::fprintf(stderr, "%-32s %12.2f %12.2f %+7.1f%%%s\n", r.name.c_str(), it->second.value, r.value, delta_pct, regressed ? "  REGRESSAO" : "");
+        }
+    }
+
+    if (!all_match){
+        return 1;
+    }
+    return regressions > 0 ? 2 : 0;
+}
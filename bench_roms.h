@@ -0,0 +1,64 @@
+#ifndef BENCH_ROMS_H
+#define BENCH_ROMS_H
+
+#include <cstdint>
+#include <vector>
+
+
+// ROMs pequenas escritas para o benchmark; dominio publico (CC0)
+struct BenchRom {
+    const char* name;
+    std::vector<uint8_t> data;
+};
+
+
+// uma familia de opcode por ROM, em loop (o salto de volta entra na medida)
+inline const std::vector<BenchRom>& opcodeFamilyRoms(){
+    static const std::vector<BenchRom> roms = {
+        // 8XYN: todas as operacoes de ALU
+        {"alu_8xyn", {
+            0x60, 0x01, 0x61, 0x02, 0x80, 0x14, 0x81, 0x05, 0x82, 0x13, 0x83, 0x21,
+            0x84, 0x32, 0x85, 0x46, 0x86, 0x4E, 0x87, 0x07, 0x88, 0x04, 0x12, 0x04}},
+        // 3XNN/4XNN/5XY0/9XY0, 2NNN/00EE e 1NNN
+        {"branch", {
+            0x60, 0x00, 0x30, 0x01, 0x40, 0x00, 0x50, 0x10, 0x90, 0x10, 0x22, 0x10,
+            0x12, 0x02, 0x00, 0x00, 0x00, 0xEE}},
+        // DXYN de 8 linhas andando pela tela
+        {"draw_dxyn", {
+            0xA0, 0x50, 0xD0, 0x18, 0x70, 0x03, 0x71, 0x01, 0x12, 0x02}},
+        // FX55/FX65 com todos os registradores
+        {"block_fx55_fx65", {
+            0xA4, 0x00, 0xFF, 0x55, 0xFF, 0x65, 0x12, 0x02}},
+    };
+    return roms;
+}
+
+// programas completos
+inline const std::vector<BenchRom>& bundledRoms(){
+    static const std::vector<BenchRom> roms = {
+        // labirinto aleatorio de diagonais (CXNN, DXYN, skips)
+        {"maze", {
+            0xA2, 0x20, 0xC2, 0x01, 0x32, 0x01, 0xA2, 0x24, 0xD0, 0x14, 0x70, 0x04,
+            0x30, 0x40, 0x12, 0x00, 0x60, 0x00, 0x71, 0x04, 0x31, 0x20, 0x12, 0x00,
+            0x00, 0xE0, 0x61, 0x00, 0x12, 0x00, 0x00, 0x00, 0x10, 0x20, 0x40, 0x80,
+            0x80, 0x40, 0x20, 0x10}},
+        // contador decimal na tela (FX33, FX65, FX29, DXYN, CLS)
+        {"bcd_counter", {
+            0x00, 0xE0, 0xA3, 0x00, 0xF3, 0x33, 0xF2, 0x65, 0x6A, 0x00, 0x6B, 0x00,
+            0xF0, 0x29, 0xDA, 0xB5, 0x7A, 0x05, 0xF1, 0x29, 0xDA, 0xB5, 0x7A, 0x05,
+            0xF2, 0x29, 0xDA, 0xB5, 0x73, 0x01, 0x12, 0x00}},
+        // sub-rotina com aritmetica e ida e volta pela memoria
+        {"subroutine", {
+            0x60, 0x00, 0x22, 0x10, 0x70, 0x01, 0x12, 0x02, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0x81, 0x00, 0x81, 0x14, 0x82, 0x16, 0xA4, 0x00,
+            0xF2, 0x55, 0xF2, 0x65, 0x81, 0x25, 0x00, 0xEE}},
+        // espera o delay timer num laco ocioso (FX07 / 3X00 / 1NNN) e conta em BCD
+        {"delay_wait", {
+            0x60, 0x05, 0xF0, 0x15, 0xF1, 0x07, 0x31, 0x00, 0x12, 0x04, 0x72, 0x01,
+            0xA3, 0x00, 0xF2, 0x33, 0x12, 0x00}},
+    };
+    return roms;
+}
+
+
+#endif // BENCH_ROMS_H
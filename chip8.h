@@ -3,14 +3,26 @@
 
 #include <cstdint>
 #include <array>
-#include <random>
+#include <bitset>
 #include <iostream>
 #include <cstring>
 #include <fstream>
 #include <string>
+#include <vector>
+#include "analysis.h"
+#include "decoder.h"
+#include "rng.h"
 
+#ifdef CHIP8_TRACE
+#include "trace.h"
+#endif
+#ifdef CHIP8_PROFILE
+#include "profile.h"
+#endif
 
 
+
+// maquina classica; cada variante define os seus em Chip8Machine<Variant>
 const unsigned int MEMORY_SIZE = 4096;
 const unsigned int NUM_REGISTERS = 16;
 const unsigned int START_ADDRESS = 0x200;
@@ -21,6 +33,14 @@ const unsigned int DISPLAY_SIZE = DISPLAY_WIDTH * DISPLAY_HEIGHT;
 const unsigned int FONT_START_ADDRESS = 0x050;
 const unsigned int FONT_END_ADDRESS = 0x0A0;
 const unsigned int FONT_CHARACTER_SIZE = 5;
+const unsigned int BIG_FONT_START_ADDRESS = 0x0A0; // SUPER-CHIP / XO-CHIP
+const unsigned int BIG_FONT_CHARACTER_SIZE = 10;
+const unsigned int RPL_FLAGS = 16;
+const unsigned int AUDIO_PATTERN_SIZE = 16; // XO-CHIP: 128 amostras de 1 bit
+
+// save state: "C8SS" + versao (u16) + estado da maquina, inteiros em little-endian
+const char SAVESTATE_MAGIC[4] = {'C', '8', 'S', 'S'};
+const uint16_t SAVESTATE_VERSION = 4;
 
 
 
@@ -44,14 +64,108 @@ const std::array<uint8_t, 80> fontset = {{
     0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 }};
 
+//fontes grandes 8x10 (SUPER-CHIP: 0-9, XO-CHIP: 0-F)
+const std::array<uint8_t, 160> bigfontset = {{
+    0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+    0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+    0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+    0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+    0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+    0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+    0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+    0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+    0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+    0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+    0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+    0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+}};
+
+
+
+// motor de execucao usado por Chip8Machine::run()
+enum class ExecEngine {
+    Interpreter, // uma instrucao por vez via cycle()
+    Block,       // blocos basicos, handlers encadeados
+    Native       // blocos traduzidos para C++ (attachNative); onde faltar, como Block
+};
+
+// timers a 60 Hz em tempo emulado: o tick N cai no ciclo ceil(N * cpu_hz / 60).
+// Frontend, batch e filmes usam o mesmo calendario, para a repeticao ser exata.
+const unsigned int TIMER_HZ = 60;
+const unsigned int DEFAULT_CPU_HZ = 700;
+
+inline uint64_t timerTickCycle(uint64_t tick, unsigned int cpu_hz){
+    return (tick * cpu_hz + TIMER_HZ - 1) / TIMER_HZ;
+}
+
+// falhas da CPU, sem excecoes. As fatais (pilha, fetch fora da memoria) param a maquina
+// na instrucao que falhou ate clearFault(); as outras so sao contadas e a execucao segue,
+// como antes (a instrucao vira NOP).
+enum class Fault : uint8_t {
+    None = 0,
+    StackOverflow,     // fatal
+    StackUnderflow,    // fatal
+    FetchOutOfBounds,  // fatal
+    MemoryOutOfBounds, // FX33/FX55/FX65/5XY2/5XY3 alem do fim da memoria
+    InvalidOpcode,
+    InvalidKey,        // EX9E/EXA1 com VX > 0xF
+    Count
+};
+
+const size_t FAULT_KINDS = static_cast<size_t>(Fault::Count);
+
+inline const char* faultName(Fault fault){
+    switch (fault){
+        case Fault::None:              return "ok";
+        case Fault::StackOverflow:     return "stack_overflow";
+        case Fault::StackUnderflow:    return "stack_underflow";
+        case Fault::FetchOutOfBounds:  return "fetch_out_of_bounds";
+        case Fault::MemoryOutOfBounds: return "memory_out_of_bounds";
+        case Fault::InvalidOpcode:     return "invalid_opcode";
+        case Fault::InvalidKey:        return "invalid_key";
+        default:                       return "unknown";
+    }
+}
+
+inline bool isFatal(Fault fault){
+    return fault == Fault::StackOverflow || fault == Fault::StackUnderflow || fault == Fault::FetchOutOfBounds;
+}
+
+// resultado de run(): instrucoes completadas e a falha fatal que parou a CPU (ou None)
+struct RunResult {
+    uint64_t executed;
+    Fault fault;
+    uint64_t idle; // quantas de executed foram puladas em laco ocioso (ver skipIdleLoop)
+};
 
+const unsigned int MAX_IDLE_LOOP = 8;  // instrucoes por volta de um laco ocioso
 
-class Chip8 {
+
+
+template <typename Variant, typename Rng = Pcg32Random>
+class Chip8Machine {
     public:
+        typedef Variant VariantType;
+        typedef Rng RngType;
+
+        static constexpr unsigned int MEMORY_SIZE = Variant::MEMORY_SIZE;
+        static constexpr unsigned int DISPLAY_WIDTH = Variant::DISPLAY_WIDTH;
+        static constexpr unsigned int DISPLAY_HEIGHT = Variant::DISPLAY_HEIGHT;
+        static constexpr unsigned int DISPLAY_SIZE = DISPLAY_WIDTH * DISPLAY_HEIGHT;
+        static constexpr unsigned int DISPLAY_PLANES = Variant::DISPLAY_PLANES;
+        static constexpr unsigned int ROW_WORDS = DISPLAY_WIDTH / 64; // palavras de 64 bits por linha
+        static_assert(DISPLAY_WIDTH % 64 == 0, "display_buffer guarda linhas em palavras de 64 bits");
+
         std::array<uint8_t, MEMORY_SIZE> memory;
         std::array<uint8_t, NUM_REGISTERS> V;
         std::array<uint16_t, STACK_LEVELS> stack;
-        std::array<uint8_t, DISPLAY_SIZE> display_buffer;
+        // plano, linha, palavra; bit 63 da primeira palavra da linha = x 0
+        typedef std::array<uint64_t, DISPLAY_PLANES * DISPLAY_HEIGHT * ROW_WORDS> DisplayBuffer;
+        DisplayBuffer display_buffer;
         std::array<uint8_t, 16> keypad;
 
 
@@ -64,30 +178,36 @@ class Chip8 {
         uint8_t key_register; //Reg Vx para FX0A
         bool display_updated;
 
-        Chip8(): rand_engine(std::random_device{}()),
-        rand_dist(0, 255),
-        key_pressed_wait(false),
-        key_register(0)
-        {
-            pc = START_ADDRESS;
+        // estado das extensoes (fica zerado no CHIP-8 classico)
+        bool hires;         // SUPER-CHIP: 128x64; em lowres cada pixel vira 2x2
+        uint8_t plane_mask; // XO-CHIP: planos selecionados por FN01
+        uint8_t audio_pitch; // XO-CHIP: FX3A
+        std::array<uint8_t, RPL_FLAGS> rpl_flags; // SUPER-CHIP: FX75/FX85
+        std::array<uint8_t, AUDIO_PATTERN_SIZE> audio_pattern; // XO-CHIP: F002
+
+        // falhas: a fatal pendente (None se a CPU esta rodando), a ultima falha
+        // de qualquer tipo e quantas de cada tipo ja ocorreram
+        Fault fault;
+        uint16_t fault_pc;     // endereco da instrucao que falhou
+        uint16_t fault_opcode;
+        std::array<uint64_t, FAULT_KINDS> fault_counts;
+
+#ifdef CHIP8_TRACE
+        Tracer* tracer = nullptr; // nullptr => trace desligado
+#endif
+#ifdef CHIP8_PROFILE
+        Profiler* profiler = nullptr; // nullptr => profiler desligado
+#endif
+
+        Chip8Machine(){
             memory.fill(0);
-            V.fill(0);
-            I = 0;
-            stack.fill(0);
-            sp = 0;
-
-            display_buffer.fill(0);
-            display_updated = false;
-
-            delay_timer = 0;
-            sound_timer = 0;
-
-            keypad.fill(0);
+            resetMachineState();
+            resetDecodeCaches();
 
-            if (FONT_END_ADDRESS > FONT_START_ADDRESS){
-                std::memcpy(&memory[FONT_START_ADDRESS], fontset.data(), fontset.size());
-            } else {
-                throw std::runtime_error("Font set overlaps with program memory start address!");
+            static_assert(FONT_END_ADDRESS > FONT_START_ADDRESS, "Font set overlaps with program memory start address!");
+            std::memcpy(&memory[FONT_START_ADDRESS], fontset.data(), fontset.size());
+            if constexpr (Variant::SUPER_CHIP){
+                std::memcpy(&memory[BIG_FONT_START_ADDRESS], bigfontset.data(), bigfontset.size());
             }
         }
 
@@ -121,10 +241,158 @@ class Chip8 {
            }
 
            rom_file.close();
-           std::cout << "ROM '" << filename << "' (" << size << " bytes) carregada com sucesso em 0x" << std::hex << START_ADDRESS << std::dec << "." << std::endl;
+           resetDecodeCaches();
            return true;
+        }
+
+        // carrega uma ROM ja em memoria (sem I/O, sem log) - usado pelos runners headless
+        bool loadRomData(const uint8_t* data, size_t size){
+            if (size > MEMORY_SIZE - START_ADDRESS) {
+                return false;
+            }
+            std::memcpy(&memory[START_ADDRESS], data, size);
+            resetDecodeCaches();
+            return true;
+        }
+
+        // decodifica de uma vez as instrucoes alcancaveis a partir de START_ADDRESS no
+        // programa [START_ADDRESS, START_ADDRESS + size) e descobre os blocos basicos que
+        // comecam em cada inicio de bloco do grafo de controle (ver analysis.h); dados e
+        // codigo so alcancavel por BNNN ficam para a decodificacao preguicosa, como sempre
+        void predecodeProgram(size_t size){
+            ProgramAnalysis<Variant> analysis;
+            analysis.analyze(memory.data(), START_ADDRESS, START_ADDRESS + size);
+            for (const CodeBlock& block : analysis.blocks()){
+                for (size_t addr = block.addr; addr < block.end; ){
+                    decoded[addr] = decodeInstr(static_cast<uint16_t>(memory[addr] << 8) | memory[addr + 1]);
+                    addr += instrSize(decoded[addr].op);
+                }
+                discoverBlock(block.addr);
+            }
+        }
+
+        // volta ao estado de power-on com a memoria e os caches de uma imagem pronta
+        // (ver RomLibrary): so copias, sem I/O nem decodificacao. O gerador aleatorio
+        // e o tracer nao mudam.
+        void loadProgram(const Chip8Machine& image){
+            memory = image.memory;
+            decoded = image.decoded;
+            block_len = image.block_len;
+            dirty_pages.set();
+            unverifyNative(0, MEMORY_SIZE);
+            forgetIdleProbes();
+            resetMachineState();
+        }
+
+        // serializa o estado completo (inclusive o gerador aleatorio) em out
+        void saveState(std::vector<uint8_t>& out) const {
+            out.clear();
+            out.reserve(savestateFixedSize());
+            for (char ch : SAVESTATE_MAGIC){
+                out.push_back(static_cast<uint8_t>(ch));
+            }
+            putLE(out, SAVESTATE_VERSION, 2);
+            out.push_back(Variant::ID);
+
+            out.insert(out.end(), memory.begin(), memory.end());
+            out.insert(out.end(), V.begin(), V.end());
+            for (uint16_t addr : stack){
+                putLE(out, addr, 2);
+            }
+            putLE(out, I, 2);
+            putLE(out, sp, 2);
+            putLE(out, pc, 2);
+            out.push_back(delay_timer);
+            out.push_back(sound_timer);
+            putLE(out, cycle_count, 8);
+            out.insert(out.end(), keypad.begin(), keypad.end());
+            out.push_back(key_pressed_wait ? 1 : 0);
+            out.push_back(key_register);
+            for (uint64_t row : display_buffer){
+                putLE(out, row, 8);
+            }
+            out.push_back(hires ? 1 : 0);
+            out.push_back(plane_mask);
+            out.push_back(audio_pitch);
+            out.insert(out.end(), rpl_flags.begin(), rpl_flags.end());
+            out.insert(out.end(), audio_pattern.begin(), audio_pattern.end());
+
+            out.push_back(Rng::ID);
+            out.resize(out.size() + Rng::STATE_SIZE);
+            rng.saveState(&out[out.size() - Rng::STATE_SIZE]);
+        }
+
+        bool loadState(const uint8_t* data, size_t size){
+            const size_t fixed_size = savestateFixedSize();
+            if (size < sizeof(SAVESTATE_MAGIC) + 2 || std::memcmp(data, SAVESTATE_MAGIC, sizeof(SAVESTATE_MAGIC)) != 0){
+                std::cerr << "Erro: save state invalido." << std::endl;
+                return false;
+            }
+            data += sizeof(SAVESTATE_MAGIC);
+            uint16_t version = static_cast<uint16_t>(getLE(data, 2));
+            if (version != SAVESTATE_VERSION){
+                std::cerr << "Erro: versao de save state nao suportada (v" << version << ")." << std::endl;
+                return false;
+            }
+            // valida o tamanho antes de tocar no estado atual
+            if (size != fixed_size){
+                std::cerr << "Erro: save state truncado." << std::endl;
+                return false;
+            }
+            const uint8_t rng_id = data[fixed_size - Rng::STATE_SIZE - 1 - sizeof(SAVESTATE_MAGIC) - 2];
+            if (*data++ != Variant::ID || rng_id != Rng::ID){
+                std::cerr << "Erro: save state de outra variante da maquina ou de outro gerador aleatorio." << std::endl;
+                return false;
+            }
+
+            // sp e key_register indexam stack e V: confere antes de aplicar. pc fora da memoria
+            // e estado legitimo (maquina parada em FetchOutOfBounds, que o rewind tem de
+            // restaurar) e nunca indexa nada: todo fetch confere o limite e falha de novo
+            const uint8_t* regs = data + MEMORY_SIZE + NUM_REGISTERS + STACK_LEVELS * 2 + 2;
+            const uint16_t new_sp = static_cast<uint16_t>(getLE(regs, 2));
+            const uint16_t new_pc = static_cast<uint16_t>(getLE(regs, 2));
+            const uint8_t new_key_register = regs[2 + 8 + keypad.size() + 1];
+            if (new_sp > STACK_LEVELS || new_key_register >= NUM_REGISTERS){
+                std::cerr << "Erro: save state corrompido (sp ou registrador de FX0A fora do intervalo)." << std::endl;
+                return false;
+            }
 
-           
+            std::memcpy(memory.data(), data, MEMORY_SIZE);
+            data += MEMORY_SIZE;
+            std::memcpy(V.data(), data, NUM_REGISTERS);
+            data += NUM_REGISTERS;
+            for (uint16_t& addr : stack){
+                addr = static_cast<uint16_t>(getLE(data, 2));
+            }
+            I = static_cast<uint16_t>(getLE(data, 2));
+            sp = new_sp;
+            pc = new_pc;
+            data += 4;
+            delay_timer = *data++;
+            sound_timer = *data++;
+            cycle_count = getLE(data, 8);
+            std::memcpy(keypad.data(), data, keypad.size());
+            data += keypad.size();
+            key_pressed_wait = (*data++ != 0);
+            key_register = new_key_register;
+            ++data;
+            for (uint64_t& row : display_buffer){
+                row = getLE(data, 8);
+            }
+            hires = (*data++ != 0);
+            plane_mask = *data++;
+            audio_pitch = *data++;
+            std::memcpy(rpl_flags.data(), data, rpl_flags.size());
+            data += rpl_flags.size();
+            std::memcpy(audio_pattern.data(), data, audio_pattern.size());
+            data += audio_pattern.size();
+            data += 1; // Rng::ID, ja conferido
+            rng.loadState(data);
+
+            resetDecodeCaches();
+            fault = Fault::None; // falhas nao fazem parte do save state; os contadores seguem
+            display_updated = true;
+            return true;
         }
 
         uint8_t getSoundTimer() const {
@@ -150,9 +418,9 @@ class Chip8 {
             }
         }
 
+        // parada em FX0A: run() nao executa nada ate handleKeyPressEvent(); so os timers andam
         bool isWaitingForKey() const {
             return key_pressed_wait;
-
         }
 
         void clearKeys(){
@@ -171,50 +439,69 @@ class Chip8 {
             }
         }
 
-        void pushStack(uint16_t address){
+        // false (e falha registrada) se a pilha estiver cheia
+        bool pushStack(uint16_t address) noexcept {
             if (sp >= STACK_LEVELS){
-                throw std::runtime_error("Stack Overflow!");
+                return false;
             }
 
             stack[sp] = address;
             sp++;
+            return true;
         }
 
-        uint16_t popStack(){
+        // false (e falha registrada) se a pilha estiver vazia
+        bool popStack(uint16_t& address) noexcept {
             if (sp == 0){
-                throw std::runtime_error("Stack Underflow!");
+                return false;
             }
 
             sp--;
-            return stack[sp];
+            address = stack[sp];
+            return true;
+        }
+
+        Fault getFault() const {
+            return fault;
+        }
+
+        // tira a CPU do estado de falha (ex.: depois de corrigir pc ou a pilha)
+        void clearFault(){
+            fault = Fault::None;
+        }
+
+        void seedRandom(uint64_t seed){
+            rng.seed(seed);
         }
 
         uint8_t getRandomByte(){
-            return static_cast<uint8_t>(rand_dist(rand_engine));
+            return rng.nextByte();
         }
 
         void clearDisplay(){
-            display_buffer.fill(0);
+            if constexpr (Variant::XO_CHIP){
+                for (unsigned int plane = 0; plane < DISPLAY_PLANES; ++plane){
+                    if (plane_mask & (1u << plane)){
+                        std::fill(planeRow(plane, 0), planeRow(plane, DISPLAY_HEIGHT), 0);
+                    }
+                }
+            } else {
+                display_buffer.fill(0);
+            }
             display_updated = true;
         }
         
+        // pixels do plano 0
         bool setPixel(int x, int y, bool state){
             x %= DISPLAY_WIDTH;
             y %= DISPLAY_HEIGHT;
 
-            size_t index = x + (y * DISPLAY_WIDTH);
-            bool collision = false;
+            uint64_t mask = state ? pixelMask(x % 64) : 0;
+            uint64_t& word = display_buffer[y * ROW_WORDS + x / 64];
+            bool collision = (word & mask) != 0;
 
-
-            bool original_state = (display_buffer[index] == 1);
-            bool new_state = original_state ^ state;
-
-            if (original_state && !new_state){
-                collision = true;
-            }
-
-            display_buffer[index] = new_state ? 1 : 0;
-            if (original_state != new_state){
+            word ^= mask;
+            if (mask != 0){
                 display_updated = true;
             }
 
@@ -224,327 +511,1207 @@ class Chip8 {
         bool getPixel(int x , int y) const {
             x %= DISPLAY_WIDTH;
             y %= DISPLAY_HEIGHT;
-            size_t index = x + (y * DISPLAY_WIDTH);
-            return display_buffer[index] == 1;
+            return (display_buffer[y * ROW_WORDS + x / 64] & pixelMask(x % 64)) != 0;
+        }
+
+        // indice de cor (um bit por plano) de um pixel
+        unsigned int getPixelColor(int x, int y) const {
+            unsigned int color = 0;
+            for (unsigned int plane = 0; plane < DISPLAY_PLANES; ++plane){
+                if (planeRow(plane, y % DISPLAY_HEIGHT)[(x % DISPLAY_WIDTH) / 64] & pixelMask(x % 64)){
+                    color |= 1u << plane;
+                }
+            }
+            return color;
+        }
+
+        uint64_t* planeRow(unsigned int plane, unsigned int y){
+            return &display_buffer[(plane * DISPLAY_HEIGHT + y) * ROW_WORDS];
+        }
+
+        const uint64_t* planeRow(unsigned int plane, unsigned int y) const {
+            return &display_buffer[(plane * DISPLAY_HEIGHT + y) * ROW_WORDS];
+        }
+
+        static uint64_t pixelMask(unsigned int x){
+            return 0x8000000000000000ULL >> x;
         }
         
-        void cycle(){
-            if (key_pressed_wait){
-                return;
+        // executa uma instrucao; devolve a falha fatal em que a CPU esta (None = ok)
+        Fault cycle() noexcept {
+            if (key_pressed_wait || fault != Fault::None){
+                return fault;
             }
 
             // fetch opcode
             if (pc > MEMORY_SIZE - 2){
-                throw std::runtime_error("out memory during fetch!");
+                return raiseFault(Fault::FetchOutOfBounds, pc, 0);
             }
 
-            uint16_t opcode = (static_cast<uint16_t>(memory[pc] << 8 ) | memory[pc + 1]);
+            // copia: o handler pode invalidar a propria entrada (codigo auto-modificavel)
+            const DecodedInstr instr = decoded[pc];
+
+#if defined(CHIP8_TRACE) || defined(CHIP8_PROFILE)
+            const uint16_t pc_fetch = pc;
+#endif
+#ifdef CHIP8_TRACE
+            // opcode lido antes do handler: FX33/FX55 podem sobrescrever a propria instrucao
+            std::array<uint8_t, NUM_REGISTERS> V_before;
+            uint16_t traced_opcode = 0;
+            if (tracer){
+                V_before = V;
+                traced_opcode = static_cast<uint16_t>(memory[pc] << 8 | memory[pc + 1]);
+            }
+#endif
+#ifdef CHIP8_PROFILE
+            // a primeira execucao de cada endereco chega como OP_UNDECODED (decodificada so
+            // dentro do handler): o profiler precisa da instrucao de fato, lida antes que ela
+            // possa se sobrescrever
+            DecodedInstr profiled = instr;
+            if (profiler && instr.op == OP_UNDECODED){
+                profiled = decodeInstr(static_cast<uint16_t>(memory[pc] << 8) | memory[pc + 1]);
+            }
+#endif
 
             pc += 2;
+            OP_HANDLERS[instr.op](*this, instr);
 
+#ifdef CHIP8_TRACE
+            if (tracer){
+                traceInstruction(pc_fetch, traced_opcode, V_before);
+            }
+#endif
+#ifdef CHIP8_PROFILE
+            if (profiler && fault == Fault::None){
+                profileInstruction(pc_fetch, profiled);
+            }
+#endif
+            return fault;
+        }
 
-            //fetch
-            uint16_t NNN = opcode & 0x0FFF;
-            uint8_t NN = opcode & 0x00FF;
-            uint8_t N = opcode & 0x000F;
-            uint8_t X = (opcode & 0x0F00) >> 8;
-            uint8_t Y = (opcode & 0x00F0) >> 4;
-            printf("PC: 0x%04X | Opcode: 0x%04X | NNN: 0x%03X | NN: 0x%02X | N: 0x%X | X: 0x%X | Y: 0x%X\n", pc -2, opcode, NNN, NN, N, X, Y); 
-
-            // decode struct
-            switch(opcode & 0xF000){
-                //00E0 (CLS), 00EE (RET)
-                case 0x0000:
-                    switch(NN){
-                        case 0xE0:
-                            printf("Opcode 00E0: CLS\n");
-                            clearDisplay();
-                            break;
-                        
-                        case 0xEE:
-
-                            printf("Opcode 0xEE: RET\n");
-                            pc = popStack();
-                            break;
-                        
-                        default:
-                            printf("Opcode 0NNN: SYS\n");
-                            break;
-                    }
-                    break;
+        // executa uma instrucao ja decodificada com pc apontando para a seguinte, como
+        // os motores fazem; usado pelo codigo gerado por chip8-recompile
+        static void execute(Chip8Machine& c, const DecodedInstr& in){
+            OP_HANDLERS[in.op](c, in);
+        }
 
-                case 0x1000: // 1NNN: JP addr - salt para NNN
-                    printf("Opcode: 1NNN: JP 0x%03X\n", NNN);
-                    pc = NNN;
-                    break;
+        // decodifica um opcode em handler + operandos (ver decoder.h)
+        static DecodedInstr decodeInstr(uint16_t opcode){
+            return decodeOpcode<Variant>(opcode);
+        }
 
-                case 0x2000:
-                    pushStack(pc);
-                    pc = NNN;
+        // descarta as instrucoes pre-decodificadas (e os blocos) que leem [addr, addr + len)
+        // e marca as paginas do trecho como escritas
+        void invalidateDecoded(size_t addr, size_t len){
+            size_t first = addr > 0 ? addr - 1 : 0; // instrucao em addr-1 le o byte addr
+            size_t last = addr + len;
+            if (last > MEMORY_SIZE){
+                last = MEMORY_SIZE;
+            }
+            for (size_t page = addr / PAGE_SIZE; page * PAGE_SIZE < last; ++page){
+                dirty_pages.set(page);
+            }
+            for (size_t a = first; a < last; ++a){
+                decoded[a] = DecodedInstr();
+            }
+
+            // qualquer bloco que comece ate MAX_BLOCK_LEN instrucoes antes pode cobrir o trecho
+            size_t block_first = first > 2 * MAX_BLOCK_LEN ? first - 2 * MAX_BLOCK_LEN : 0;
+            for (size_t a = block_first; a < last; ++a){
+                block_len[a] = 0;
+            }
+            unverifyNative(addr, last);
+            for (size_t a = addr; a < last; ++a){
+                if (idle_probed[a]){
+                    forgetIdleProbes(); // um laco pode pular para qualquer lugar
                     break;
+                }
+            }
+        }
 
-                case 0x3000:
-                    if (V[X] == NN){
-                        pc += 2;
+        // executa ate max_cycles instrucoes com o motor escolhido; para antes se
+        // a CPU entrar em espera de tecla (FX0A) ou numa falha fatal.
+        RunResult run(uint64_t max_cycles, ExecEngine engine = ExecEngine::Interpreter) noexcept {
+            bool skip_idle = true;
+
+#ifdef CHIP8_TRACE
+            if (tracer){
+                engine = ExecEngine::Interpreter; // trace e por instrucao
+                skip_idle = false;
+            }
+#endif
+#ifdef CHIP8_PROFILE
+            if (profiler){
+                engine = ExecEngine::Interpreter; // profiler tambem
+                skip_idle = false;
+            }
+#endif
+
+            // o frontend e o batch chamam run() uma vez por tick: um jogo esperando o
+            // delay timer ja chega aqui dentro do laco
+            uint64_t idle = skip_idle ? skipIdleLoop(max_cycles) : 0;
+            uint64_t executed = idle;
+
+            if (engine == ExecEngine::Interpreter){
+                while (executed < max_cycles && !key_pressed_wait && fault == Fault::None){
+                    if (cycle() != Fault::None){
+                        break; // a instrucao que falhou nao conta
                     }
+                    ++executed;
+                }
+                return RunResult{executed, fault, idle};
+            }
+
+            // motor de blocos: espera, falha e limites checados uma vez por bloco.
+            // So RET, CALL e F000 falham de forma fatal, e todas encerram bloco.
+            while (executed < max_cycles && !key_pressed_wait && fault == Fault::None){
+                if (pc > MEMORY_SIZE - 2){
+                    raiseFault(Fault::FetchOutOfBounds, pc, 0);
                     break;
-                
-                case 0x4000:
-                    if (V[X] != NN){
+                }
+
+                uint64_t count;
+                uint8_t last_op;
+                // Native: o bloco traduzido, se couber inteiro no que resta do orcamento
+                const NativeBlock* native = engine == ExecEngine::Native ? nativeBlockAt(pc) : nullptr;
+                if (native && native->len <= max_cycles - executed){
+                    native->run(*this);
+                    count = native->len;
+                    last_op = native->last_op;
+                } else {
+                    count = block_len[pc];
+                    if (count == 0){
+                        count = discoverBlock(pc);
+                    }
+                    if (count > max_cycles - executed){
+                        count = max_cycles - executed;
+                    }
+
+                    const DecodedInstr* instr = &decoded[pc];
+                    const DecodedInstr* block_end = instr + 2 * count;
+                    while (instr != block_end){
                         pc += 2;
+                        OP_HANDLERS[instr->op](*this, *instr);
+                        instr += 2; // decoded e indexado por endereco de byte
                     }
-                    break;
+                    last_op = block_end[-2].op;
+                }
+                executed += count;
+                if (fault != Fault::None){
+                    --executed; // a ultima instrucao do bloco falhou
+                } else if (skip_idle && last_op == OP_JP){
+                    // laco que so entrou agora, no meio do orcamento
+                    uint64_t skipped = skipIdleLoop(max_cycles - executed);
+                    executed += skipped;
+                    idle += skipped;
+                }
+            }
+            return RunResult{executed, fault, idle};
+        }
 
-                case 0x5000:
-                    if (N == 0){
-                        if (V[X] == V[Y]){
-                            pc += 2;
-                        }
-                    } else {
-                        printf("Opcode desconhecida (base 5xxx com nibbie final nao zero):0x%04X\n", opcode);
+        // ---- codigo nativo (ver chip8-recompile) ----
+        // Um bloco traduzido executa as len instrucoes a partir de addr de uma vez, com o
+        // mesmo efeito do motor de blocos. code guarda os bytes que foram traduzidos: depois
+        // de uma escrita no trecho (ou de trocar a memoria inteira) o bloco so volta a ser
+        // usado se a memoria ainda for igual a eles; senao o endereco e interpretado.
+        struct NativeBlock {
+            uint16_t addr;
+            uint8_t len;                // instrucoes, ate MAX_BLOCK_LEN
+            uint8_t last_op;            // OpKind da ultima (JP => procura laco ocioso)
+            const uint8_t* code;        // 2 * len bytes
+            void (*run)(Chip8Machine&); // deixa pc na instrucao seguinte ao bloco
+        };
+
+        // os blocos (que devem durar mais que a maquina) valem para ExecEngine::Native;
+        // count 0 desliga. Blocos que passariam do fim da memoria sao ignorados.
+        void attachNative(const NativeBlock* blocks, size_t count){
+            native_slots.clear();
+            native_bytes.reset();
+            if (count == 0){
+                return;
+            }
+            native_slots.resize(MEMORY_SIZE);
+            for (size_t b = 0; b < count; ++b){
+                if (blocks[b].len > 0 && blocks[b].len <= MAX_BLOCK_LEN && static_cast<size_t>(blocks[b].addr) + 2 * static_cast<size_t>(blocks[b].len) <= MEMORY_SIZE){
+                    native_slots[blocks[b].addr].block = &blocks[b];
+                    for (size_t a = blocks[b].addr; a < blocks[b].addr + 2 * static_cast<size_t>(blocks[b].len); ++a){
+                        native_bytes.set(a);
                     }
-                    break;
+                }
+            }
+        }
 
-                case 0x6000:
-                    V[X] = NN;
-                    break;
+        // ---- fork copy-on-write (ver fork.h) ----
+        // A memoria e vista em paginas de 256 bytes. Escritas da CPU (FX33, FX55, 5XY2) e
+        // cargas inteiras (ROM, imagem, save state) marcam paginas sujas, para um fork
+        // copiar so o que mudou desde clearDirtyPages().
+        static constexpr unsigned int PAGE_SIZE = 256;
+        static constexpr unsigned int MEMORY_PAGES = MEMORY_SIZE / PAGE_SIZE;
+        static_assert(MEMORY_SIZE % PAGE_SIZE == 0, "memoria em paginas inteiras");
+
+        bool isPageDirty(size_t page) const {
+            return dirty_pages[page];
+        }
+
+        void clearDirtyPages(){
+            dirty_pages.reset();
+        }
+
+        // tudo menos memoria, tela e caches: o que um fork guarda por inteiro
+        struct CpuState {
+            std::array<uint8_t, NUM_REGISTERS> V;
+            std::array<uint16_t, STACK_LEVELS> stack;
+            uint16_t I;
+            uint16_t sp;
+            uint16_t pc;
+            uint8_t delay_timer;
+            uint8_t sound_timer;
+            uint64_t cycle_count;
+            std::array<uint8_t, 16> keypad;
+            bool key_pressed_wait;
+            uint8_t key_register;
+            bool hires;
+            uint8_t plane_mask;
+            uint8_t audio_pitch;
+            std::array<uint8_t, RPL_FLAGS> rpl_flags;
+            std::array<uint8_t, AUDIO_PATTERN_SIZE> audio_pattern;
+            Fault fault;
+            uint16_t fault_pc;
+            uint16_t fault_opcode;
+            std::array<uint64_t, FAULT_KINDS> fault_counts;
+            Rng rng;
+        };
+
+        void saveCpuState(CpuState& out) const {
+            out.V = V;
+            out.stack = stack;
+            out.I = I;
+            out.sp = sp;
+            out.pc = pc;
+            out.delay_timer = delay_timer;
+            out.sound_timer = sound_timer;
+            out.cycle_count = cycle_count;
+            out.keypad = keypad;
+            out.key_pressed_wait = key_pressed_wait;
+            out.key_register = key_register;
+            out.hires = hires;
+            out.plane_mask = plane_mask;
+            out.audio_pitch = audio_pitch;
+            out.rpl_flags = rpl_flags;
+            out.audio_pattern = audio_pattern;
+            out.fault = fault;
+            out.fault_pc = fault_pc;
+            out.fault_opcode = fault_opcode;
+            out.fault_counts = fault_counts;
+            out.rng = rng;
+        }
+
+        void loadCpuState(const CpuState& in){
+            V = in.V;
+            stack = in.stack;
+            I = in.I;
+            sp = in.sp;
+            pc = in.pc;
+            delay_timer = in.delay_timer;
+            sound_timer = in.sound_timer;
+            cycle_count = in.cycle_count;
+            keypad = in.keypad;
+            key_pressed_wait = in.key_pressed_wait;
+            key_register = in.key_register;
+            hires = in.hires;
+            plane_mask = in.plane_mask;
+            audio_pitch = in.audio_pitch;
+            rpl_flags = in.rpl_flags;
+            audio_pattern = in.audio_pattern;
+            fault = in.fault;
+            fault_pc = in.fault_pc;
+            fault_opcode = in.fault_opcode;
+            fault_counts = in.fault_counts;
+            rng = in.rng;
+        }
+
+        // ---- tempo emulado ----
+        // A maquina tem o proprio relogio em ciclos de CPU (cycleCount(), no save state) e
+        // runFor() da o tick dos timers exatamente no ciclo timerTickCycle(N, cpu_hz), entre
+        // duas instrucoes, sem depender do relogio do host. Em espera de tecla (FX0A), ou com
+        // a CPU ja parada numa falha, o tempo passa sem executar; uma falha nova encerra a
+        // chamada na instrucao que falhou, com o relogio parado ali. run() continua sendo so
+        // "execute ate N instrucoes", sem relogio nem timers.
+
+        RunResult runFor(uint64_t cycles, ExecEngine engine = ExecEngine::Interpreter) noexcept {
+            RunResult total{0, fault, 0};
+            const uint64_t end = cycle_count + cycles;
+            uint64_t ticks = ticksAt(cycle_count);
+            while (cycle_count < end){
+                uint64_t next_tick = nextTickCycle();
+                uint64_t stop = next_tick < end ? next_tick : end;
+                if (fault == Fault::None){
+                    RunResult chunk = run(stop - cycle_count, engine);
+                    total.executed += chunk.executed;
+                    total.idle += chunk.idle;
+                    if (chunk.fault != Fault::None){
+                        cycle_count += chunk.executed; // sem espera de tecla no meio: o ciclo exato da falha
+                        total.fault = chunk.fault;
+                        return total;
+                    }
+                }
+                cycle_count = stop;
+                // abaixo de 60 Hz de CPU cabe mais de um tick no mesmo ciclo
+                for (uint64_t due = ticksAt(stop); ticks < due; ++ticks){
+                    updateTimers();
+                }
+            }
+            total.fault = fault;
+            return total;
+        }
+
+        // ate o proximo tick dos timers, inclusive
+        RunResult runUntilFrame(ExecEngine engine = ExecEngine::Interpreter) noexcept {
+            return runFor(nextTickCycle() - cycle_count, engine);
+        }
+
+        uint64_t cycleCount() const {
+            return cycle_count;
+        }
+
+        uint64_t nextTickCycle() const {
+            return timerTickCycle(ticksAt(cycle_count) + 1, cpu_hz);
+        }
+
+        // velocidade da sessao (nao vai no save state); pode mudar a qualquer momento
+        void setCpuHz(unsigned int hz){
+            cpu_hz = hz > 0 ? hz : DEFAULT_CPU_HZ;
+        }
+
+        unsigned int getCpuHz() const {
+            return cpu_hz;
+        }
+
+    private:
+        Rng rng; // semeado com DEFAULT_RANDOM_SEED; use seedRandom() para outra sequencia
+        uint64_t cycle_count;                 // ciclos emulados desde o reset, contados por runFor()
+        unsigned int cpu_hz = DEFAULT_CPU_HZ;
+
+        // cache de instrucoes pre-decodificadas, indexado por pc
+        std::array<DecodedInstr, MEMORY_SIZE> decoded;
+
+        // tamanho (em instrucoes) do bloco basico que comeca em cada pc; 0 = nao descoberto
+        std::array<uint8_t, MEMORY_SIZE> block_len;
+
+        std::bitset<MEMORY_PAGES> dirty_pages; // paginas escritas desde clearDirtyPages()
+
+        // por pc, se algum laco ocioso pode comecar ali (ver idleReachable): com NEVER o
+        // motor de blocos nao simula nada a cada JP. idle_probed marca os bytes que essas
+        // conclusoes leram; so uma escrita neles as desfaz.
+        enum IdleShape : uint8_t { IDLE_UNKNOWN, IDLE_NEVER, IDLE_MAYBE };
+        std::array<uint8_t, MEMORY_SIZE> idle_shape;
+        std::bitset<MEMORY_SIZE> idle_probed;
+
+        // blocos nativos por endereco de inicio (vazio sem attachNative()); verified = os
+        // bytes ja foram comparados com code desde a ultima escrita no trecho
+        struct NativeSlot {
+            const NativeBlock* block = nullptr;
+            bool verified = false;
+        };
+        std::vector<NativeSlot> native_slots;
+        std::bitset<MEMORY_SIZE> native_bytes; // bytes cobertos por algum bloco de native_slots
+
+        // bloco nativo em addr, se a memoria ainda tiver o codigo que foi traduzido
+        const NativeBlock* nativeBlockAt(uint16_t addr){
+            if (native_slots.empty()){
+                return nullptr;
+            }
+            NativeSlot& slot = native_slots[addr];
+            if (slot.block && !slot.verified){
+                slot.verified = std::memcmp(&memory[addr], slot.block->code, 2 * slot.block->len) == 0;
+                if (!slot.verified){
+                    return nullptr;
+                }
+            }
+            return slot.block;
+        }
+
+        // blocos nativos com algum byte em [first, last) voltam a ser conferidos; escritas
+        // em dados (fora de native_bytes) nao custam mais que essa consulta
+        void unverifyNative(size_t first, size_t last){
+            if (native_slots.empty()){
+                return;
+            }
+            bool covered = false;
+            for (size_t a = first; a < last && !covered; ++a){
+                covered = native_bytes[a];
+            }
+            if (!covered){
+                return;
+            }
+            size_t a = first >= 2 * MAX_BLOCK_LEN ? first - 2 * MAX_BLOCK_LEN + 1 : 0;
+            for (; a < last; ++a){
+                NativeSlot& slot = native_slots[a];
+                if (slot.block && a + 2 * slot.block->len > first){
+                    slot.verified = false;
+                }
+            }
+        }
+
+        // ticks ja dados ate o ciclo c: os N com timerTickCycle(N) <= c, ou seja
+        // floor(c * 60 / cpu_hz). O calendario sai do relogio, nada a guardar
+        uint64_t ticksAt(uint64_t c) const {
+            return c * TIMER_HZ / cpu_hz;
+        }
+
+        static constexpr size_t savestateFixedSize(){
+            return sizeof(SAVESTATE_MAGIC) + 2 + 1 + MEMORY_SIZE + NUM_REGISTERS + STACK_LEVELS * 2
+                + 3 * 2 + 2 + 8 + 16 + 2 + DISPLAY_PLANES * DISPLAY_HEIGHT * ROW_WORDS * 8
+                + 3 + RPL_FLAGS + AUDIO_PATTERN_SIZE + 1 + Rng::STATE_SIZE;
+        }
+
+        static void putLE(std::vector<uint8_t>& out, uint64_t value, int bytes){
+            for (int i = 0; i < bytes; ++i){
+                out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+            }
+        }
+
+        static uint64_t getLE(const uint8_t*& data, int bytes){
+            uint64_t value = 0;
+            for (int i = 0; i < bytes; ++i){
+                value |= static_cast<uint64_t>(*data++) << (8 * i);
+            }
+            return value;
+        }
+
+        // registradores, pilha, tela, timers, teclado e estado das extensoes (nao mexe na memoria)
+        void resetMachineState(){
+            pc = START_ADDRESS;
+            V.fill(0);
+            I = 0;
+            stack.fill(0);
+            sp = 0;
+
+            display_buffer.fill(0);
+            display_updated = false;
+
+            delay_timer = 0;
+            sound_timer = 0;
+            cycle_count = 0;
+
+            keypad.fill(0);
+            key_pressed_wait = false;
+            key_register = 0;
+
+            hires = false;
+            plane_mask = 1;
+            audio_pitch = 64; // 4000 Hz
+            rpl_flags.fill(0);
+            audio_pattern.fill(0);
+
+            fault = Fault::None;
+            fault_pc = 0;
+            fault_opcode = 0;
+            fault_counts.fill(0);
+        }
 
-                case 0x7000:
-                    V[X] += NN;
+        // memoria trocada por inteiro: caches fora, todas as paginas sujas e os blocos
+        // nativos a conferir de novo
+        void resetDecodeCaches(){
+            decoded.fill(DecodedInstr());
+            block_len.fill(0);
+            dirty_pages.set();
+            unverifyNative(0, MEMORY_SIZE);
+            forgetIdleProbes();
+        }
+
+        // decodifica a sequencia linear a partir de start e guarda o tamanho do bloco
+        uint8_t discoverBlock(uint16_t start){
+            uint8_t count = 0;
+            size_t addr = start;
+            while (count < MAX_BLOCK_LEN && addr <= MEMORY_SIZE - 2){
+                DecodedInstr& instr = decoded[addr];
+                if (instr.op == OP_UNDECODED){
+                    instr = decodeInstr(static_cast<uint16_t>(memory[addr] << 8 ) | memory[addr + 1]);
+                }
+                ++count;
+                if (endsBlock(instr.op)){
                     break;
-                
-                case 0x8000:
-                    switch (N){
-                        case 0x0:
-                            V[X] = V[Y];
-                            break;
-                        case 0x1:
-                            V[X] |= V[Y];
-                            break;
-
-                        case 0x2:
-                            V[X] &= V[Y];
-                            break;
-
-                        case 0x3:
-                            V[X] ^= V[Y];
-                            break;
-                        case 0x4:
-                            {
-                                uint16_t sum = static_cast<uint16_t>(V[X]) + 
-                                static_cast<uint16_t>(V[Y]);
-                                V[0xF] = (sum > 0xFF) ? 1 : 0;
-                                V[X] = static_cast<uint8_t>(sum);
+                }
+                addr += 2;
+            }
+            block_len[start] = count;
+            return count;
+        }
 
+        // laco ocioso: uma volta a partir de pc que so le o delay timer, o teclado e
+        // constantes e volta a pc sem efeito alem de V (ex.: FX07 / 3X00 / 1NNN esperando
+        // o timer zerar). Timers e teclado so mudam entre chamadas de run(), entao depois
+        // da primeira volta o estado se repete: pula voltas inteiras do orcamento de uma
+        // vez, deixando V como ficaria e pc no mesmo lugar. O resto (< uma volta) roda
+        // normal, entao ciclos, timers e estado final sao os mesmos de executar tudo.
+        uint64_t skipIdleLoop(uint64_t budget){
+            if (budget < 2 || key_pressed_wait || fault != Fault::None){
+                return 0; // uma instrucao so: pular nao economiza nada
+            }
+            if (idle_shape[pc] == IDLE_UNKNOWN){
+                idle_shape[pc] = idleReachable(pc, 1, false) ? IDLE_MAYBE : IDLE_NEVER;
+            }
+            if (idle_shape[pc] == IDLE_NEVER){
+                return 0;
+            }
+            std::array<uint8_t, NUM_REGISTERS> regs = V;
+            unsigned int length = idleIteration(regs);
+            if (length == 0 || budget < length){
+                return 0;
+            }
+            std::array<uint8_t, NUM_REGISTERS> again = regs;
+            if (idleIteration(again) != length || again != regs){
+                return 0; // a segunda volta ainda muda algo: nao e ponto fixo
+            }
+            V = regs;
+            return budget - budget % length;
+        }
+
+        void forgetIdleProbes(){
+            idle_shape.fill(IDLE_UNKNOWN);
+            idle_probed.reset();
+        }
+
+        // idleIteration sem estado: algum caminho (tomando ou nao cada skip) de at volta a
+        // pc em ate MAX_IDLE_LOOP instrucoes so com as que ela aceita, lendo o delay timer
+        // ou o teclado no caminho? Sem essa leitura so o JP para si mesmo conta: um laco so
+        // de constantes que mudasse de volta para volta seria simulado a cada JP a toa.
+        bool idleReachable(uint16_t at, unsigned int count, bool reads_input){
+            if (count > MAX_IDLE_LOOP || at > MEMORY_SIZE - 2){
+                return false;
+            }
+            idle_probed.set(at);
+            idle_probed.set(at + 1);
+            DecodedInstr in = decoded[at];
+            if (in.op == OP_UNDECODED){
+                in = decodeInstr(static_cast<uint16_t>(memory[at] << 8) | memory[at + 1]);
+            }
+            uint16_t next = at + 2;
+            switch (in.op){
+                case OP_LD_VX_DT:
+                    reads_input = true;
+                    break;
+                case OP_LD_IMM:
+                    break;
+                case OP_SKP:
+                case OP_SKNP:
+                    reads_input = true;
+                    [[fallthrough]];
+                case OP_SE_IMM:
+                case OP_SNE_IMM:
+                case OP_SE_REG:
+                case OP_SNE_REG: {
+                    uint16_t skipped = next;
+                    if constexpr (Variant::XO_CHIP){
+                        if (skipped <= MEMORY_SIZE - 2){
+                            idle_probed.set(skipped);
+                            idle_probed.set(skipped + 1);
+                            if (memory[skipped] == 0xF0 && memory[skipped + 1] == 0x00){
+                                skipped += 2;
                             }
-                            break;
-
-                        case 0x5:
-                            V[0xF] = (V[X] >= V[Y]) ? 1 : 0;
-                            V[X] -= V[Y];
-                            break;
-                             
-                        case 0x6:
-                            V[0xF] = V[X] & 0x1;
-
-                            V[X] >>= 1;
-                            break;
-                        
-
-                        case 0x7:
-                            V[0xF] = (V[Y] >= V[X]) ? 1 : 0;
-                            V[X] = V[Y] - V[X];
-                            break;
-                        
-                        case 0xE:
-                            V[0xF] = (V[X] & 0x80) >> 7;
-                            V[X] <<= 1;
-                            break;
-
-                        default:
-                            printf("Opcode 0x8XXX desconhecida (N = %X): 0x%04X\n", N, opcode);
-                        
-                            break;
+                        }
+                    }
+                    skipped += 2;
+                    if (skipped == pc ? reads_input : idleReachable(skipped, count + 1, reads_input)){
+                        return true;
                     }
                     break;
+                }
+                case OP_JP:
+                    next = in.nnn;
+                    break;
+                default:
+                    return false;
+            }
+            if (next == pc){
+                return reads_input || count == 1;
+            }
+            return idleReachable(next, count + 1, reads_input);
+        }
 
-                case 0x9000:
-                    if (N == 0){
-                        if(V[X] != V[Y]){
-                            pc += 2;
+        // simula uma volta a partir de pc sobre regs; devolve o numero de instrucoes
+        // ate voltar a pc, ou 0 se sair do laco ou passar por algo com efeito
+        unsigned int idleIteration(std::array<uint8_t, NUM_REGISTERS>& regs) const {
+            uint16_t at = pc;
+            for (unsigned int count = 1; count <= MAX_IDLE_LOOP; ++count){
+                if (at > MEMORY_SIZE - 2){
+                    return 0;
+                }
+                DecodedInstr in = decoded[at];
+                if (in.op == OP_UNDECODED){
+                    in = decodeInstr(static_cast<uint16_t>(memory[at] << 8) | memory[at + 1]);
+                }
+                uint16_t next = at + 2;
+                bool skip = false;
+                switch (in.op){
+                    case OP_LD_VX_DT: regs[in.x] = delay_timer; break;
+                    case OP_LD_IMM:   regs[in.x] = in.nn; break;
+                    case OP_SE_IMM:   skip = regs[in.x] == in.nn; break;
+                    case OP_SNE_IMM:  skip = regs[in.x] != in.nn; break;
+                    case OP_SE_REG:   skip = regs[in.x] == regs[in.y]; break;
+                    case OP_SNE_REG:  skip = regs[in.x] != regs[in.y]; break;
+                    case OP_SKP:
+                    case OP_SKNP:
+                        if (regs[in.x] > 0xF){
+                            return 0; // contaria falha
+                        }
+                        skip = (keypad[regs[in.x]] == 1) == (in.op == OP_SKP);
+                        break;
+                    case OP_JP:       next = in.nnn; break;
+                    default:
+                        return 0;
+                }
+                if (skip){
+                    if constexpr (Variant::XO_CHIP){
+                        if (next <= MEMORY_SIZE - 2 && memory[next] == 0xF0 && memory[next + 1] == 0x00){
+                            next += 2;
                         }
-                    } else {
-                        printf("Opcode desconhecida (base 9XXX com nibble final nao zero): 0x%04X\n", opcode);
                     }
-                    break;
+                    next += 2;
+                }
+                if (next == pc){
+                    return count;
+                }
+                at = next;
+            }
+            return 0;
+        }
 
-                case 0xA000:
-                    I = NNN;
-                    break;
+        typedef void (*OpHandler)(Chip8Machine&, const DecodedInstr&);
+        static const OpHandler OP_HANDLERS[OP_COUNT];
 
-                case 0xB000:
-                    pc = V[0] + NNN;
-                    break;
-                
+        // ---- handlers (pc ja aponta para a proxima instrucao) ----
 
-                case 0xC000:
-                    {
-                        uint8_t random_byte = getRandomByte();
-                        V[X] = random_byte & NN;
-                    }
+        // entrada ainda nao decodificada: decodifica, guarda e executa
+        static void opUndecoded(Chip8Machine& c, const DecodedInstr&){
+            uint16_t addr = c.pc - 2;
+            uint16_t opcode = (static_cast<uint16_t>(c.memory[addr] << 8 ) | c.memory[addr + 1]);
+            const DecodedInstr instr = decodeInstr(opcode);
+            c.decoded[addr] = instr;
+            OP_HANDLERS[instr.op](c, instr);
+        }
+
+        static void opInvalid(Chip8Machine& c, const DecodedInstr& in){
+            c.raiseFault(Fault::InvalidOpcode, c.pc - 2, in.opcode);
+        }
+
+        static void opCls(Chip8Machine& c, const DecodedInstr&){
+            c.clearDisplay();
+        }
+
+        static void opRet(Chip8Machine& c, const DecodedInstr& in){
+            uint16_t address;
+            if (!c.popStack(address)){
+                c.raiseFault(Fault::StackUnderflow, c.pc - 2, in.opcode);
+                return;
+            }
+            c.pc = address;
+        }
+
+        static void opSys(Chip8Machine&, const DecodedInstr&){
+        }
+
+        static void opJp(Chip8Machine& c, const DecodedInstr& in){ // 1NNN: JP addr - salt para NNN
+            c.pc = in.nnn;
+        }
+
+        static void opCall(Chip8Machine& c, const DecodedInstr& in){
+            if (!c.pushStack(c.pc)){
+                c.raiseFault(Fault::StackOverflow, c.pc - 2, in.opcode);
+                return;
+            }
+            c.pc = in.nnn;
+        }
+
+        static void opSeImm(Chip8Machine& c, const DecodedInstr& in){
+            if (c.V[in.x] == in.nn){
+                skipNext(c);
+            }
+        }
+
+        static void opSneImm(Chip8Machine& c, const DecodedInstr& in){
+            if (c.V[in.x] != in.nn){
+                skipNext(c);
+            }
+        }
+
+        static void opSeReg(Chip8Machine& c, const DecodedInstr& in){
+            if (c.V[in.x] == c.V[in.y]){
+                skipNext(c);
+            }
+        }
+
+        static void opLdImm(Chip8Machine& c, const DecodedInstr& in){
+            c.V[in.x] = in.nn;
+        }
+
+        static void opAddImm(Chip8Machine& c, const DecodedInstr& in){
+            c.V[in.x] += in.nn;
+        }
+
+        static void opLdReg(Chip8Machine& c, const DecodedInstr& in){
+            c.V[in.x] = c.V[in.y];
+        }
+
+        static void opOr(Chip8Machine& c, const DecodedInstr& in){
+            c.V[in.x] |= c.V[in.y];
+        }
+
+        static void opAnd(Chip8Machine& c, const DecodedInstr& in){
+            c.V[in.x] &= c.V[in.y];
+        }
+
+        static void opXor(Chip8Machine& c, const DecodedInstr& in){
+            c.V[in.x] ^= c.V[in.y];
+        }
+
+        static void opAddReg(Chip8Machine& c, const DecodedInstr& in){
+            uint16_t sum = static_cast<uint16_t>(c.V[in.x]) + 
+            static_cast<uint16_t>(c.V[in.y]);
+            c.V[0xF] = (sum > 0xFF) ? 1 : 0;
+            c.V[in.x] = static_cast<uint8_t>(sum);
+        }
+
+        static void opSub(Chip8Machine& c, const DecodedInstr& in){
+            c.V[0xF] = (c.V[in.x] >= c.V[in.y]) ? 1 : 0;
+            c.V[in.x] -= c.V[in.y];
+        }
+
+        static void opShr(Chip8Machine& c, const DecodedInstr& in){
+            c.V[0xF] = c.V[in.x] & 0x1;
+            c.V[in.x] >>= 1;
+        }
+
+        static void opSubn(Chip8Machine& c, const DecodedInstr& in){
+            c.V[0xF] = (c.V[in.y] >= c.V[in.x]) ? 1 : 0;
+            c.V[in.x] = c.V[in.y] - c.V[in.x];
+        }
+
+        static void opShl(Chip8Machine& c, const DecodedInstr& in){
+            c.V[0xF] = (c.V[in.x] & 0x80) >> 7;
+            c.V[in.x] <<= 1;
+        }
+
+        static void opSneReg(Chip8Machine& c, const DecodedInstr& in){
+            if (c.V[in.x] != c.V[in.y]){
+                skipNext(c);
+            }
+        }
+
+        static void opLdI(Chip8Machine& c, const DecodedInstr& in){
+            c.I = in.nnn;
+        }
+
+        static void opJpV0(Chip8Machine& c, const DecodedInstr& in){
+            c.pc = c.V[0] + in.nnn;
+        }
+
+        static void opRnd(Chip8Machine& c, const DecodedInstr& in){
+            uint8_t random_byte = c.getRandomByte();
+            c.V[in.x] = random_byte & in.nn;
+        }
+
+        static void opDrw(Chip8Machine& c, const DecodedInstr& in){
+            if constexpr (Variant::SUPER_CHIP){
+                drawExtended(c, in);
+                return;
+            }
+
+            unsigned int coordX = c.V[in.x] % DISPLAY_WIDTH;
+            uint8_t coordY = c.V[in.y];
+            uint8_t height = in.nn & 0x0F;
+            uint64_t collision = 0;
+
+            for(int yline = 0; yline < height; ++yline){
+                if(c.I + yline >= MEMORY_SIZE){
                     break;
+                }
 
-                case 0xD000:
-                    {
-                        uint8_t coordX = V[X];
-                        uint8_t coordY = V[Y];
-                        uint8_t height = N;
-                        V[0xF] = 0;
+                // linha do sprite alinhada em x com wrap horizontal: um rotate
+                uint64_t sprite_row = static_cast<uint64_t>(c.memory[c.I + yline]) << 56;
+                sprite_row = (sprite_row >> coordX) | (sprite_row << ((DISPLAY_WIDTH - coordX) % DISPLAY_WIDTH));
 
-                        for(int yline = 0; yline < height; ++yline){
-                            if(I + yline >= MEMORY_SIZE){
-                                break;
-                            }
-                            uint8_t sprite_byte = memory[I + yline];
-                            uint16_t screenY = (coordY + yline);
+                uint64_t& screen_row = c.display_buffer[(coordY + yline) % DISPLAY_HEIGHT];
+                collision |= screen_row & sprite_row;
+                screen_row ^= sprite_row;
+            }
 
+            c.V[0xF] = collision != 0 ? 1 : 0;
+            c.display_updated = true;
+        }
 
-                            for (int xpixel = 0; xpixel < 8; ++xpixel){
-                                if((sprite_byte & (0x80 >> xpixel)) != 0){
-                                    uint16_t screenX = (coordX + xpixel);
+        static void opSkp(Chip8Machine& c, const DecodedInstr& in){
+            uint8_t key_code = c.V[in.x];
+            if (key_code > 0xF){
+                c.raiseFault(Fault::InvalidKey, c.pc - 2, in.opcode);
+                return;
+            }
+            if(c.keypad[key_code] == 1){
+                skipNext(c);
+            }
+        }
 
-                                    uint16_t wrappedX = screenX % DISPLAY_WIDTH;
-                                    uint16_t wrappedY = screenY % DISPLAY_HEIGHT;
+        static void opSknp(Chip8Machine& c, const DecodedInstr& in){
+            uint8_t key_code = c.V[in.x];
+            if (key_code > 0xF){
+                c.raiseFault(Fault::InvalidKey, c.pc - 2, in.opcode);
+                return;
+            }
+            if(c.keypad[key_code] == 0){
+                skipNext(c);
+            }
+        }
 
-                                    size_t index = wrappedX + (wrappedY * DISPLAY_WIDTH);
+        static void opLdVxDt(Chip8Machine& c, const DecodedInstr& in){
+            c.V[in.x] = c.delay_timer;
+        }
 
-                                    if (display_buffer[index] == 1){
-                                        V[0xF] = 1;
-                                    }
+        static void opLdVxK(Chip8Machine& c, const DecodedInstr& in){
+            c.key_pressed_wait = true;
+            c.key_register = in.x;
+        }
 
-                                    display_buffer[index] ^= 1;
-                                }
-                            }
-                        }
+        static void opLdDtVx(Chip8Machine& c, const DecodedInstr& in){
+            c.delay_timer = c.V[in.x];
+        }
 
-                        display_updated = true;
+        static void opLdStVx(Chip8Machine& c, const DecodedInstr& in){
+            c.sound_timer = c.V[in.x];
+        }
+
+        static void opAddIVx(Chip8Machine& c, const DecodedInstr& in){
+            c.I += c.V[in.x];
+        }
 
+        static void opLdFVx(Chip8Machine& c, const DecodedInstr& in){
+            uint8_t digit = c.V[in.x] & 0x0F;
+            c.I = FONT_START_ADDRESS + (digit * FONT_CHARACTER_SIZE);
+        }
+
+        static void opLdBVx(Chip8Machine& c, const DecodedInstr& in){
+            uint8_t value = c.V[in.x];
+            if(c.I + 2 >= MEMORY_SIZE){
+                c.raiseFault(Fault::MemoryOutOfBounds, c.pc - 2, in.opcode);
+            } else {
+                c.memory[c.I] = value / 100; // centenas
+                c.memory[c.I+1] = (value / 10) % 10; //dezenas
+                c.memory[c.I+2] = value % 10; // unidades
+                c.invalidateDecoded(c.I, 3);
+            }
+        }
+
+        static void opLdIVx(Chip8Machine& c, const DecodedInstr& in){
+            if (c.I + in.x >= MEMORY_SIZE){
+                c.raiseFault(Fault::MemoryOutOfBounds, c.pc - 2, in.opcode);
+            } else {
+                for ( uint8_t i = 0; i <= in.x; ++i){
+                    c.memory[c.I + i] = c.V[i];
+                }
+                c.invalidateDecoded(c.I, in.x + 1);
+            }
+        }
+
+        static void opLdVxI(Chip8Machine& c, const DecodedInstr& in){
+            if(c.I + in.x >= MEMORY_SIZE){
+                c.raiseFault(Fault::MemoryOutOfBounds, c.pc - 2, in.opcode);
+            } else {
+                for (uint8_t i = 0; i <= in.x; ++i){
+                    c.V[i] = c.memory[c.I + i];
+                }
+            }
+        }
+
+        // registra a falha; as fatais param a CPU com pc de volta na instrucao que falhou
+        Fault raiseFault(Fault kind, uint16_t at_pc, uint16_t opcode) noexcept {
+            fault_pc = at_pc;
+            fault_opcode = opcode;
+            ++fault_counts[static_cast<size_t>(kind)];
+            if (isFatal(kind)){
+                fault = kind;
+                pc = at_pc;
+            }
+            return fault;
+        }
+
+        // skip: XO-CHIP pula os 4 bytes de F000 NNNN
+        static void skipNext(Chip8Machine& c){
+            if constexpr (Variant::XO_CHIP){
+                if (c.pc <= MEMORY_SIZE - 2 && c.memory[c.pc] == 0xF0 && c.memory[c.pc + 1] == 0x00){
+                    c.pc += 2;
+                }
+            }
+            c.pc += 2;
+        }
+
+        // ---- extensoes SUPER-CHIP / XO-CHIP ----
+
+        // desenha DXYN (DXY0 = 16x16) nos planos selecionados; em lowres cada pixel vira 2x2
+        static void drawExtended(Chip8Machine& c, const DecodedInstr& in){
+            unsigned int n = in.nn & 0x0F;
+            unsigned int rows = (n == 0) ? 16 : n;
+            unsigned int scale = c.hires ? 1 : 2;
+            unsigned int coordX = (c.V[in.x] * scale) % DISPLAY_WIDTH;
+            unsigned int coordY = (c.V[in.y] * scale) % DISPLAY_HEIGHT;
+            uint32_t addr = c.I;
+            uint64_t collision = 0;
+
+            for (unsigned int plane = 0; plane < DISPLAY_PLANES; ++plane){
+                if (!(c.plane_mask & (1u << plane))){
+                    continue;
+                }
+                for (unsigned int row = 0; row < rows; ++row){
+                    // bits da linha alinhados no topo de 32 bits
+                    uint32_t bits;
+                    if (n == 0){
+                        if (addr + 1 >= MEMORY_SIZE) break;
+                        bits = static_cast<uint32_t>((c.memory[addr] << 8) | c.memory[addr + 1]) << 16;
+                        addr += 2;
+                    } else {
+                        if (addr >= MEMORY_SIZE) break;
+                        bits = static_cast<uint32_t>(c.memory[addr]) << 24;
+                        addr += 1;
                     }
-                    break;
+                    if (!c.hires){
+                        bits = doubleBits(bits >> 16);
+                    }
+                    for (unsigned int s = 0; s < scale; ++s){
+                        collision |= xorRow(c.planeRow(plane, (coordY + row * scale + s) % DISPLAY_HEIGHT), bits, coordX);
+                    }
+                }
+            }
 
-                case 0xE000:
-                        {
-                            uint8_t key_code = V[X];
+            c.V[0xF] = collision != 0 ? 1 : 0;
+            c.display_updated = true;
+        }
 
-                            if (key_code > 0xF){
-                                printf("Aviso: Tentativa de verificar tecla inválida (Vx=0x%X) em opcode ExXX (0x%04X)\n", key_code, opcode);
-                                break;
-                            }
+        // cada bit dos 16 de baixo vira dois (lowres), resultado alinhado no topo
+        static uint32_t doubleBits(uint32_t value){
+            uint32_t out = 0;
+            for (int bit = 15; bit >= 0; --bit){
+                out = (out << 2) | (((value >> bit) & 1) * 3);
+            }
+            return out;
+        }
 
-                            switch (NN){
-                                case 0x9E:
-                                    if(keypad[key_code] == 1){
-                                        pc += 2;
-                                    }
-                                    break;
-
-                                case 0xA1:
-                                    if(keypad[key_code] == 0){
-                                        pc += 2;
-                                    }
-                                    break;
-                                default:
-                                    printf("Opcode EXXX desconhecida (NN = %02X): 0x%04X\n", NN, opcode);
-                                    break;
-                            }
-                        }
-                        break;
+        // XOR de ate 32 bits na linha a partir de x (com wrap); devolve os bits apagados
+        static uint64_t xorRow(uint64_t* row, uint32_t bits, unsigned int x){
+            unsigned int word = x / 64;
+            unsigned int shift = x % 64;
+            uint64_t sprite = static_cast<uint64_t>(bits) << 32;
+            uint64_t lo = sprite >> shift;
+            uint64_t hi_spill = shift ? sprite << (64 - shift) : 0;
+
+            uint64_t& first = row[word];
+            uint64_t& second = row[(word + 1) % ROW_WORDS];
+            uint64_t collision = (first & lo);
+            first ^= lo;
+            collision |= (second & hi_spill);
+            second ^= hi_spill;
+            return collision;
+        }
 
+        template <typename Fn>
+        static void forEachSelectedPlane(Chip8Machine& c, Fn fn){
+            for (unsigned int plane = 0; plane < DISPLAY_PLANES; ++plane){
+                if (c.plane_mask & (1u << plane)){
+                    fn(plane);
+                }
+            }
+            c.display_updated = true;
+        }
 
-                case 0xF000:
-                        switch(NN){
-                            case 0x07:
-                                V[X] = delay_timer;
-                                break;
-
-                            case 0x0A:
-                                key_pressed_wait = true;
-                                key_register = X;
-                                break;
-
-                            case 0x15:
-
-                                delay_timer = V[X];
-                                break;
-
-                            case 0x18:
-                                sound_timer = V[X];
-                                break;
-
-                            case 0x1E:
-                                I += V[X];
-                                break;
-
-                            case 0x29:
-                                {
-                                    uint8_t digit = V[X] & 0x0F;
-                                    I = FONT_START_ADDRESS + (digit * FONT_CHARACTER_SIZE);
-                                }
-                                break;
-
-                            case 0x33:
-                                {
-                                    uint8_t value = V[X];
-                                    if(I + 2 >= MEMORY_SIZE){
-                                        fprintf(stderr, "Erro: Escrita BCD fora dos limites da memória (I=0x%X)\n", I);
-                                    } else {
-                                        memory[I] = value / 100; // centenas
-                                        memory[I+1] = (value / 10) % 10; //dezenas
-                                        memory[I+2] = value % 10; // unidades
-                                    }
-                                }
-                                break;
-                            
-                            case 0x55:
-                                if (I + X >= MEMORY_SIZE){
-                                    fprintf(stderr, "Erro: Escrita LD [I], Vx fora dos limites (I=0x%X, X=%d)\n", I, X);
-                                } else {
-                                    for ( uint8_t i = 0; i <= X; ++i){
-                                        memory[I + i] = V[i];
-                                    }
-                                }
-                                break;
-
-                            case 0x65:
-                                if(I + X >= MEMORY_SIZE){
-                                    fprintf(stderr, "Erro: Leitura LD Vx, [I] fora dos limites (I=0x%X, X=%d)\n", I, X);
-                                } else {
-                                    for (uint8_t i = 0; i <= X; ++i){
-                                        V[i] = memory[I + i];
-                                    }
-                                }
-                                break;
-
-                            default:
-                            printf("Opcode FXXX desconhecida (NN = %02X): 0x%04X\n", NN, opcode);
-                            break;
-                            
-                        }
-                        break;
-                        
+        static void opScrollDown(Chip8Machine& c, const DecodedInstr& in){ // 00CN
+            unsigned int n = in.nn & 0x0F;
+            forEachSelectedPlane(c, [&](unsigned int plane){
+                for (unsigned int y = DISPLAY_HEIGHT; y-- > 0;){
+                    uint64_t* row = c.planeRow(plane, y);
+                    if (y >= n){
+                        std::memcpy(row, c.planeRow(plane, y - n), ROW_WORDS * sizeof(uint64_t));
+                    } else {
+                        std::fill(row, row + ROW_WORDS, 0);
+                    }
+                }
+            });
+        }
+
+        static void opScrollUp(Chip8Machine& c, const DecodedInstr& in){ // 00DN
+            unsigned int n = in.nn & 0x0F;
+            forEachSelectedPlane(c, [&](unsigned int plane){
+                for (unsigned int y = 0; y < DISPLAY_HEIGHT; ++y){
+                    uint64_t* row = c.planeRow(plane, y);
+                    if (y + n < DISPLAY_HEIGHT){
+                        std::memcpy(row, c.planeRow(plane, y + n), ROW_WORDS * sizeof(uint64_t));
+                    } else {
+                        std::fill(row, row + ROW_WORDS, 0);
+                    }
+                }
+            });
+        }
+
+        static void opScrollRight(Chip8Machine& c, const DecodedInstr&){ // 00FB: 4 pixels
+            forEachSelectedPlane(c, [&](unsigned int plane){
+                for (unsigned int y = 0; y < DISPLAY_HEIGHT; ++y){
+                    uint64_t* row = c.planeRow(plane, y);
+                    for (unsigned int w = ROW_WORDS; w-- > 0;){
+                        row[w] = (row[w] >> 4) | (w > 0 ? row[w - 1] << 60 : 0);
+                    }
+                }
+            });
+        }
+
+        static void opScrollLeft(Chip8Machine& c, const DecodedInstr&){ // 00FC: 4 pixels
+            forEachSelectedPlane(c, [&](unsigned int plane){
+                for (unsigned int y = 0; y < DISPLAY_HEIGHT; ++y){
+                    uint64_t* row = c.planeRow(plane, y);
+                    for (unsigned int w = 0; w < ROW_WORDS; ++w){
+                        row[w] = (row[w] << 4) | (w + 1 < ROW_WORDS ? row[w + 1] >> 60 : 0);
+                    }
+                }
+            });
+        }
+
+        static void opExit(Chip8Machine& c, const DecodedInstr&){ // 00FD: fica parado nesta instrucao
+            c.pc -= 2;
+        }
+
+        static void opLowres(Chip8Machine& c, const DecodedInstr&){
+            c.hires = false;
+            c.display_buffer.fill(0);
+            c.display_updated = true;
+        }
+
+        static void opHires(Chip8Machine& c, const DecodedInstr&){
+            c.hires = true;
+            c.display_buffer.fill(0);
+            c.display_updated = true;
+        }
+
+        static void opLdHfVx(Chip8Machine& c, const DecodedInstr& in){ // FX30
+            uint8_t digit = c.V[in.x] & 0x0F;
+            c.I = BIG_FONT_START_ADDRESS + (digit * BIG_FONT_CHARACTER_SIZE);
+        }
+
+        static void opLdRVx(Chip8Machine& c, const DecodedInstr& in){ // FX75
+            for (uint8_t i = 0; i <= in.x; ++i){
+                c.rpl_flags[i] = c.V[i];
+            }
+        }
+
+        static void opLdVxR(Chip8Machine& c, const DecodedInstr& in){ // FX85
+            for (uint8_t i = 0; i <= in.x; ++i){
+                c.V[i] = c.rpl_flags[i];
+            }
+        }
+
+        static void opSaveRange(Chip8Machine& c, const DecodedInstr& in){ // 5XY2: [I] = VX..VY, I nao muda
+            int step = in.x <= in.y ? 1 : -1;
+            unsigned int count = (in.x <= in.y ? in.y - in.x : in.x - in.y) + 1;
+            if (c.I + count > MEMORY_SIZE){
+                c.raiseFault(Fault::MemoryOutOfBounds, c.pc - 2, in.opcode);
+                return;
+            }
+            for (unsigned int i = 0; i < count; ++i){
+                c.memory[c.I + i] = c.V[in.x + step * static_cast<int>(i)];
+            }
+            c.invalidateDecoded(c.I, count);
+        }
+
+        static void opLoadRange(Chip8Machine& c, const DecodedInstr& in){ // 5XY3: VX..VY = [I]
+            int step = in.x <= in.y ? 1 : -1;
+            unsigned int count = (in.x <= in.y ? in.y - in.x : in.x - in.y) + 1;
+            if (c.I + count > MEMORY_SIZE){
+                c.raiseFault(Fault::MemoryOutOfBounds, c.pc - 2, in.opcode);
+                return;
+            }
+            for (unsigned int i = 0; i < count; ++i){
+                c.V[in.x + step * static_cast<int>(i)] = c.memory[c.I + i];
+            }
+        }
+
+        static void opLdILong(Chip8Machine& c, const DecodedInstr& in){ // F000 NNNN
+            if (c.pc > MEMORY_SIZE - 2){
+                c.raiseFault(Fault::FetchOutOfBounds, c.pc - 2, in.opcode);
+                return;
+            }
+            c.I = static_cast<uint16_t>((c.memory[c.pc] << 8) | c.memory[c.pc + 1]);
+            c.pc += 2;
+        }
+
+        static void opPlane(Chip8Machine& c, const DecodedInstr& in){ // FN01
+            c.plane_mask = in.x & ((1u << DISPLAY_PLANES) - 1);
+        }
+
+        static void opAudio(Chip8Machine& c, const DecodedInstr&){ // F002
+            for (unsigned int i = 0; i < AUDIO_PATTERN_SIZE; ++i){
+                c.audio_pattern[i] = c.memory[(c.I + i) % MEMORY_SIZE];
+            }
+        }
+
+        static void opPitch(Chip8Machine& c, const DecodedInstr& in){ // FX3A
+            c.audio_pitch = c.V[in.x];
+        }
+
+#ifdef CHIP8_PROFILE
+        void profileInstruction(uint16_t pc_fetch, const DecodedInstr& instr){
+            profiler->onInstruction(pc_fetch, instr.op);
+            switch (instr.op){
+                case OP_CALL:
+                    profiler->onCall(instr.nnn, sp);
+                    break;
+                case OP_RET:
+                    profiler->onReturn(sp);
+                    break;
+                case OP_JP:
+                    profiler->onJump(pc_fetch, instr.nnn);
+                    break;
+                case OP_DRW:
+                    profiler->onDraw(pc_fetch, V[0xF] != 0);
+                    break;
                 default:
-                    printf("Opcode Desconhecida ou não implementada: 0x%04X\n", opcode);
                     break;
             }
-
         }
+#endif
+
+#ifdef CHIP8_TRACE
+        void traceInstruction(uint16_t pc_fetch, uint16_t opcode, const std::array<uint8_t, NUM_REGISTERS>& V_before){
+            TraceRecord rec;
+            rec.pc = pc_fetch;
+            rec.opcode = opcode;
+            rec.I = I;
+            rec.v_mask = 0;
+            for (unsigned int i = 0; i < NUM_REGISTERS; ++i){
+                rec.V[i] = V[i];
+                if (V[i] != V_before[i]){
+                    rec.v_mask |= static_cast<uint16_t>(1u << i);
+                }
+            }
+            tracer->record(rec);
+        }
+#endif
 
-    private:
-        std::default_random_engine rand_engine;
-        std::uniform_int_distribution<unsigned int> rand_dist;
+};
 
+// tabela de dispatch, na mesma ordem de OpKind
+template <typename Variant, typename Rng>
+const typename Chip8Machine<Variant, Rng>::OpHandler Chip8Machine<Variant, Rng>::OP_HANDLERS[OP_COUNT] = {
+    &Chip8Machine::opUndecoded, &Chip8Machine::opInvalid,
+    &Chip8Machine::opCls, &Chip8Machine::opRet, &Chip8Machine::opSys, &Chip8Machine::opJp, &Chip8Machine::opCall,
+    &Chip8Machine::opSeImm, &Chip8Machine::opSneImm, &Chip8Machine::opSeReg, &Chip8Machine::opLdImm, &Chip8Machine::opAddImm,
+    &Chip8Machine::opLdReg, &Chip8Machine::opOr, &Chip8Machine::opAnd, &Chip8Machine::opXor, &Chip8Machine::opAddReg,
+    &Chip8Machine::opSub, &Chip8Machine::opShr, &Chip8Machine::opSubn, &Chip8Machine::opShl, &Chip8Machine::opSneReg,
+    &Chip8Machine::opLdI, &Chip8Machine::opJpV0, &Chip8Machine::opRnd, &Chip8Machine::opDrw, &Chip8Machine::opSkp, &Chip8Machine::opSknp,
+    &Chip8Machine::opLdVxDt, &Chip8Machine::opLdVxK, &Chip8Machine::opLdDtVx, &Chip8Machine::opLdStVx, &Chip8Machine::opAddIVx,
+    &Chip8Machine::opLdFVx, &Chip8Machine::opLdBVx, &Chip8Machine::opLdIVx, &Chip8Machine::opLdVxI,
+    &Chip8Machine::opScrollDown, &Chip8Machine::opScrollRight, &Chip8Machine::opScrollLeft, &Chip8Machine::opExit,
+    &Chip8Machine::opLowres, &Chip8Machine::opHires, &Chip8Machine::opLdHfVx, &Chip8Machine::opLdRVx, &Chip8Machine::opLdVxR,
+    &Chip8Machine::opScrollUp, &Chip8Machine::opSaveRange, &Chip8Machine::opLoadRange, &Chip8Machine::opLdILong,
+    &Chip8Machine::opPlane, &Chip8Machine::opAudio, &Chip8Machine::opPitch
 };
 
+// o CHIP-8 classico, usado pelas ferramentas headless
+typedef Chip8Machine<ClassicChip8> Chip8;
 
 
 
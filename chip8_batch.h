@@ -0,0 +1,568 @@
+#ifndef CHIP8_BATCH_H
+#define CHIP8_BATCH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include "chip8.h"
+
+
+// N maquinas CHIP-8 classicas em passo travado (lockstep), para varreduras grandes.
+//
+// Os registros quentes ficam em estrutura de arrays, uma coluna por registro e
+// uma entrada por pista (V[r][pista], pc, I, timers). Memoria, pilha, teclado e
+// framebuffer (64 bits por linha) continuam num Chip8 por pista.
+//
+// A cada passo o lider e o menor pc entre as pistas; as pistas nesse pc com o
+// mesmo codigo executam juntas. ULA, loads, skips, saltos e timers rodam como um
+// laco sobre as colunas, sem desvios (mascara + selecao), que o compilador
+// vetoriza; RND anda junto mas tira o byte do gerador de cada pista. O resto
+// (desenho, pilha, memoria, teclado) cai no Chip8::cycle() da propria pista,
+// entao a semantica e sempre a do nucleo escalar.
+// Pegar o menor pc faz as pistas que se separaram num skip voltarem a andar juntas.
+//
+// "Mesmo codigo" sem ler a memoria de cada pista: pistas carregadas da mesma
+// imagem tem o mesmo code_id, e cada uma guarda a faixa que ja escreveu (FX33/FX55);
+// fora dessa faixa a memoria dela e igual a da imagem.
+class Chip8Batch {
+    public:
+        explicit Chip8Batch(size_t lane_count)
+            : lane_count(lane_count), machines(lane_count), v(NUM_REGISTERS * lane_count),
+              pc(lane_count), I(lane_count), delay(lane_count), sound(lane_count), stalled(lane_count),
+              code_id(lane_count, 0), dirty_lo(lane_count), dirty_hi(lane_count),
+              mask(lane_count), budget(lane_count), remaining(lane_count), dropped(lane_count) {
+            for (size_t lane = 0; lane < lane_count; ++lane){
+                pullLane(lane);
+                clearDirty(lane);
+            }
+        }
+
+        size_t size() const {
+            return lane_count;
+        }
+
+        // ---- preparacao e entrada, por pista ----
+
+        // a imagem nao pode mudar enquanto houver pistas carregadas dela
+        void loadProgram(size_t lane, const Chip8& image){
+            machines[lane].loadProgram(image);
+            std::map<const Chip8*, uint32_t>::const_iterator known = image_ids.find(&image);
+            if (known == image_ids.end()){
+                known = image_ids.insert(std::make_pair(&image, static_cast<uint32_t>(image_ids.size() + 1))).first;
+            }
+            code_id[lane] = known->second;
+            clearDirty(lane);
+            pullLane(lane);
+        }
+
+        void seedRandom(size_t lane, uint64_t seed){
+            machines[lane].seedRandom(seed);
+        }
+
+        void setKeyPressed(size_t lane, uint8_t key_index){
+            machines[lane].setKeyPressed(key_index);
+        }
+
+        void setKeyReleased(size_t lane, uint8_t key_index){
+            machines[lane].setKeyReleased(key_index);
+        }
+
+        void handleKeyPressEvent(size_t lane, uint8_t key_index){
+            pushLane(lane);
+            machines[lane].handleKeyPressEvent(key_index);
+            pullLane(lane);
+        }
+
+        // estado completo da pista (registros copiados de volta para o Chip8 dela)
+        const Chip8& lane(size_t index){
+            pushLane(index);
+            return machines[index];
+        }
+
+        // ---- execucao ----
+
+        // tick de 60 Hz em todas as pistas
+        void updateTimers(){
+            for (size_t l = 0; l < lane_count; ++l){
+                delay[l] -= delay[l] > 0;
+                sound[l] -= sound[l] > 0;
+            }
+        }
+
+        // tick de uma pista so (sessoes com relogios diferentes)
+        void updateTimers(size_t lane){
+            delay[lane] -= delay[lane] > 0;
+            sound[lane] -= sound[lane] > 0;
+        }
+
+        // executa ate budgets[pista] instrucoes em cada pista, com as mesmas regras de
+        // Chip8::run(): uma pista para antes em espera de tecla (FX0A) ou falha fatal.
+        // Orcamentos acima de 2^32 - 1 por chamada sao cortados (um quadro usa bem menos).
+        // Retorna o total executado; lastExecuted(pista) da o de cada uma.
+        uint64_t run(const uint64_t* budgets){
+            for (size_t l = 0; l < lane_count; ++l){
+                budget[l] = static_cast<uint32_t>(std::min<uint64_t>(budgets[l], UINT32_MAX));
+                remaining[l] = stalled[l] ? 0 : budget[l];
+                dropped[l] = budget[l] - remaining[l];
+            }
+
+            bool rescan = true;
+            uint32_t at = NO_PC;
+            for (;;){
+                // lider: menor pc entre as pistas que ainda tem ciclos. Depois de um passo
+                // so vetorial ele ja vem calculado do proprio passo
+                if (rescan){
+                    at = NO_PC;
+                    for (size_t l = 0; l < lane_count; ++l){
+                        at = std::min<uint32_t>(at, remaining[l] ? pc[l] : NO_PC);
+                    }
+                }
+                if (at == NO_PC){
+                    break;
+                }
+                size_t leader = 0;
+                while (pc[leader] != at || !remaining[leader]){
+                    ++leader;
+                }
+
+                // fetch fora da memoria ou codigo que o lider ja reescreveu: todas as pistas
+                // nesse pc no escalar, numa passada so
+                if (at > Chip8::MEMORY_SIZE - 2 || !cleanAt(leader, at)){
+                    for (size_t l = leader; l < lane_count; ++l){
+                        if (remaining[l] && pc[l] == at){
+                            stepScalar(l);
+                        }
+                    }
+                    rescan = true;
+                    continue;
+                }
+                const Chip8& head = machines[leader];
+                const DecodedInstr in = Chip8::decodeInstr(static_cast<uint16_t>(head.memory[at] << 8) | head.memory[at + 1]);
+
+                Group group = stepGroup(in, static_cast<uint16_t>(at), code_id[leader]);
+                rescan = !group.vector || group.strays || group.size == 1;
+                at = group.next_at;
+
+                // no lider mas com codigo diferente (outra ROM, auto-modificado): uma a uma
+                if (group.strays){
+                    for (size_t l = 0; l < lane_count; ++l){
+                        if (remaining[l] && pc[l] == group.at && !mask[l]){
+                            stepScalar(l);
+                        }
+                    }
+                }
+
+                // pista sozinha (laco de espera, caminho raro): segue no escalar ate
+                // alcancar as outras, sem varrer todas as pistas a cada instrucao
+                if (group.size == 1 && !group.strays){
+                    // as outras pistas nao andaram; a mais atrasada delas e o alvo
+                    uint32_t next_pc = NO_PC;
+                    for (size_t l = 0; l < lane_count; ++l){
+                        if (l != leader && remaining[l]){
+                            next_pc = std::min<uint32_t>(next_pc, pc[l]);
+                        }
+                    }
+                    runScalar(leader, next_pc);
+                }
+            }
+
+            uint64_t total = 0;
+            for (size_t l = 0; l < lane_count; ++l){
+                total += lastExecuted(l);
+            }
+            return total;
+        }
+
+        // mesmo orcamento para todas as pistas
+        uint64_t run(uint64_t max_cycles){
+            std::vector<uint64_t> budgets(lane_count, max_cycles);
+            return run(budgets.data());
+        }
+
+        // instrucoes completadas pela pista no ultimo run()
+        uint64_t lastExecuted(size_t lane) const {
+            return budget[lane] - remaining[lane] - dropped[lane];
+        }
+
+        Fault getFault(size_t lane) const {
+            return stalled[lane] ? machines[lane].fault : Fault::None;
+        }
+
+    private:
+        // pc nunca passa de MEMORY_SIZE + 2 (salto para 0xFFF seguido de pulo), entao
+        // 0xFFFF serve de "nenhum" e as reducoes de pc cabem em 16 bits
+        static constexpr uint16_t NO_PC = 0xFFFF;
+        static_assert(Chip8::MEMORY_SIZE + 2 < NO_PC, "NO_PC precisa ficar fora da memoria");
+
+        struct Group {
+            uint32_t at;      // pc do lider
+            uint32_t size;    // pistas que executaram junto com o lider
+            uint32_t strays;  // pistas no pc do lider com outro codigo
+            uint32_t next_at; // menor pc das pistas vivas depois do passo
+            bool vector;      // o passo foi so vetorial (next_at vale)
+        };
+
+        size_t lane_count;
+        std::vector<Chip8> machines;
+
+        // colunas de registros; V[r] da pista l em v[r * lane_count + l]
+        std::vector<uint8_t> v;
+        std::vector<uint16_t> pc;
+        std::vector<uint16_t> I;
+        std::vector<uint8_t> delay;
+        std::vector<uint8_t> sound;
+        std::vector<uint8_t> stalled; // espera de tecla (FX0A) ou falha fatal: nao executa
+
+        // identidade do codigo: imagem de origem + faixa ja escrita [dirty_lo, dirty_hi]
+        std::vector<uint32_t> code_id;
+        std::vector<uint16_t> dirty_lo;
+        std::vector<uint16_t> dirty_hi;
+        std::map<const Chip8*, uint32_t> image_ids;
+
+        // estado de run()
+        std::vector<uint8_t> mask; // pistas do passo atual
+        std::vector<uint32_t> budget;
+        std::vector<uint32_t> remaining;
+        std::vector<uint32_t> dropped; // ciclos nao usados por espera de tecla ou falha
+
+        uint8_t* reg(unsigned int index){
+            return &v[index * lane_count];
+        }
+
+        void clearDirty(size_t lane){
+            dirty_lo[lane] = 0xFFFF;
+            dirty_hi[lane] = 0;
+        }
+
+        // a instrucao em at (2 bytes) ainda e a da imagem?
+        bool cleanAt(size_t lane, uint32_t at) const {
+            return at + 1 < dirty_lo[lane] || at > dirty_hi[lane];
+        }
+
+        // instrucoes de faixa (FX55, FX65 e afins) usam todos os registros V; as outras,
+        // no maximo X, Y, VF e V0 (BNNN)
+        static bool usesAllRegs(const DecodedInstr& in){
+            switch (in.op){
+                case OP_LD_I_VX: case OP_LD_VX_I: case OP_LD_R_VX: case OP_LD_VX_R:
+                case OP_SAVE_RANGE: case OP_LOAD_RANGE:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        // colunas -> Chip8 da pista
+        void pushLane(size_t lane){
+            Chip8& c = machines[lane];
+            for (unsigned int r = 0; r < NUM_REGISTERS; ++r){
+                c.V[r] = v[r * lane_count + lane];
+            }
+            pushControl(lane);
+        }
+
+        // so os registros que in usa: cada V e uma coluna, e copiar os 16 a cada passo
+        // escalar custa mais que a propria instrucao
+        void pushLane(size_t lane, const DecodedInstr& in){
+            if (usesAllRegs(in)){
+                pushLane(lane);
+                return;
+            }
+            Chip8& c = machines[lane];
+            const uint8_t regs[] = {0, in.x, in.y, 0xF};
+            for (uint8_t r : regs){
+                c.V[r] = v[r * lane_count + lane];
+            }
+            pushControl(lane);
+        }
+
+        void pushControl(size_t lane){
+            Chip8& c = machines[lane];
+            c.pc = pc[lane];
+            c.I = I[lane];
+            c.delay_timer = delay[lane];
+            c.sound_timer = sound[lane];
+        }
+
+        // Chip8 da pista -> colunas
+        void pullLane(size_t lane){
+            const Chip8& c = machines[lane];
+            for (unsigned int r = 0; r < NUM_REGISTERS; ++r){
+                v[r * lane_count + lane] = c.V[r];
+            }
+            pullControl(lane);
+        }
+
+        void pullLane(size_t lane, const DecodedInstr& in){
+            if (usesAllRegs(in)){
+                pullLane(lane);
+                return;
+            }
+            const Chip8& c = machines[lane];
+            const uint8_t regs[] = {0, in.x, in.y, 0xF};
+            for (uint8_t r : regs){
+                v[r * lane_count + lane] = c.V[r];
+            }
+            pullControl(lane);
+        }
+
+        void pullControl(size_t lane){
+            const Chip8& c = machines[lane];
+            pc[lane] = c.pc;
+            I[lane] = c.I;
+            delay[lane] = c.delay_timer;
+            sound[lane] = c.sound_timer;
+            stalled[lane] = c.key_pressed_wait || c.fault != Fault::None;
+        }
+
+        // uma instrucao no Chip8 da pista (registros ja empurrados)
+        void cycleLane(size_t lane){
+            const Chip8& c = machines[lane];
+            DecodedInstr in;
+            if (c.pc <= Chip8::MEMORY_SIZE - 2){
+                in = Chip8::decodeInstr(static_cast<uint16_t>(c.memory[c.pc] << 8) | c.memory[c.pc + 1]);
+            }
+            cycleLane(lane, in);
+        }
+
+        // idem, com a instrucao em pc ja decodificada
+        void cycleLane(size_t lane, const DecodedInstr& in){
+            Chip8& c = machines[lane];
+
+            // FX33 e FX55 escrevem na memoria: a faixa deixa de ser igual a da imagem
+            unsigned int len = in.op == OP_LD_B_VX ? 3 : in.op == OP_LD_I_VX ? in.x + 1u : 0;
+            if (len && c.I < Chip8::MEMORY_SIZE){
+                dirty_lo[lane] = std::min<uint16_t>(dirty_lo[lane], c.I);
+                dirty_hi[lane] = std::max<uint16_t>(dirty_hi[lane], std::min<unsigned int>(c.I + len - 1, Chip8::MEMORY_SIZE - 1));
+            }
+
+            if (c.cycle() == Fault::None){
+                --remaining[lane];
+            }
+            if (c.key_pressed_wait || c.fault != Fault::None){
+                dropped[lane] += remaining[lane];
+                remaining[lane] = 0;
+            }
+        }
+
+        // uma instrucao no nucleo escalar
+        void stepScalar(size_t lane){
+            pushLane(lane);
+            cycleLane(lane);
+            pullLane(lane);
+        }
+
+        // idem, sabendo que a instrucao da pista e in (grupo com o codigo do lider)
+        void stepScalar(size_t lane, const DecodedInstr& in){
+            pushLane(lane, in);
+            cycleLane(lane, in);
+            pullLane(lane, in);
+        }
+
+        // pista sozinha no escalar ate pc >= stop_pc ou o fim do orcamento, copiando
+        // os registros uma vez so
+        void runScalar(size_t lane, uint32_t stop_pc){
+            pushLane(lane);
+            while (remaining[lane] && machines[lane].pc < stop_pc){
+                cycleLane(lane);
+            }
+            pullLane(lane);
+        }
+
+        // m ? a : b com m em {0, 1}, por mascara: o GCC nao converte em selecao um
+        // ?: que alimenta min ou escreve em V, e o laco deixa de vetorizar
+        template <typename T>
+        static T blend(uint32_t m, T a, T b){
+            const T k = static_cast<T>(0u - m);
+            return static_cast<T>((a & k) | (b & static_cast<T>(~k)));
+        }
+
+        // controle de um passo de grupo, num laco so e sem desvios: mascara (pistas em
+        // at com o codigo do lider), contagem, pc e orcamento. skip(l) so le registros
+        // e devolve 1 se a pista l pula a proxima instrucao
+        template <typename Skip>
+        static void forGroup(Group& group, size_t n, uint32_t code, bool jump, uint16_t target,
+                uint16_t* __restrict pcs, uint32_t* __restrict rem, uint8_t* __restrict masks,
+                const uint32_t* __restrict codes, const uint16_t* __restrict lo, const uint16_t* __restrict hi, Skip skip){
+            const uint32_t at = group.at;
+            uint32_t size = 0;
+            uint32_t strays = 0;
+            uint16_t next_at = NO_PC;
+            for (size_t l = 0; l < n; ++l){
+                // & e | em vez de && e ||: o laco vira selecoes, sem desvio
+                const uint32_t lane_pc = pcs[l];
+                const uint32_t live = rem[l] != 0;
+                const uint32_t here = live & (lane_pc == at);
+                const uint32_t clean = (at + 1u < lo[l]) | (at > hi[l]);
+                const uint32_t m = here & (codes[l] == code) & clean;
+                masks[l] = static_cast<uint8_t>(m);
+                size += m;
+                strays += here & (m ^ 1u);
+
+                const uint32_t new_pc = blend<uint32_t>(jump, target, lane_pc + 2 + 2 * skip(l));
+                const uint32_t new_rem = rem[l] - m;
+                pcs[l] = static_cast<uint16_t>(blend(m, new_pc, lane_pc));
+                rem[l] = new_rem;
+                next_at = std::min(next_at, blend<uint16_t>(new_rem != 0, blend(m, new_pc, lane_pc), NO_PC));
+            }
+            group.size = size;
+            group.strays = strays;
+            group.next_at = next_at;
+        }
+
+        // trabalho da instrucao nos registros, pista a pista, sob a mascara do grupo.
+        // Fica separado do controle: escritas em V (uint8_t) podem apontar para qualquer
+        // coisa, e no mesmo laco o compilador teria de testar cada coluna antes de
+        // vetorizar; aqui sobram so Vx, Vy e VF, que podem ser a mesma
+        template <typename Op>
+        static void forMask(size_t n, const uint8_t* __restrict masks, Op op){
+            for (size_t l = 0; l < n; ++l){
+                op(l, masks[l]);
+            }
+        }
+
+        // executa in no grupo do lider: vetorial quando ha caminho, senao o nucleo
+        // escalar em cada pista do grupo
+        Group stepGroup(const DecodedInstr& in, uint16_t at, uint32_t code){
+            Group group = {at, 0, 0, NO_PC, true};
+            const size_t n = lane_count;
+            uint8_t* const vx = reg(in.x);
+            uint8_t* const vy = reg(in.y);
+            uint8_t* const vf = reg(0xF);
+            uint16_t* const is = I.data();
+            uint8_t* const dts = delay.data();
+            uint8_t* const sts = sound.data();
+            const uint8_t nn = in.nn;
+            const uint16_t nnn = in.nnn;
+
+            auto control = [&](bool jump, auto skip){
+                forGroup(group, n, code, jump, nnn, pc.data(), remaining.data(), mask.data(),
+                    code_id.data(), dirty_lo.data(), dirty_hi.data(), skip);
+            };
+            auto apply = [&](auto op){
+                control(false, [](size_t){ return 0u; });
+                forMask(n, mask.data(), op);
+            };
+
+            // cada caso repete, na mesma ordem, o handler correspondente do Chip8
+            // (inclusive relendo Vx/Vy depois de escrever VF, para X ou Y = F)
+            switch (in.op){
+                case OP_SYS:
+                    control(false, [](size_t){ return 0u; });
+                    break;
+                case OP_JP:
+                    control(true, [](size_t){ return 0u; });
+                    break;
+                case OP_SE_IMM:
+                    control(false, [=](size_t l){ return static_cast<uint32_t>(vx[l] == nn); });
+                    break;
+                case OP_SNE_IMM:
+                    control(false, [=](size_t l){ return static_cast<uint32_t>(vx[l] != nn); });
+                    break;
+                case OP_SE_REG:
+                    control(false, [=](size_t l){ return static_cast<uint32_t>(vx[l] == vy[l]); });
+                    break;
+                case OP_SNE_REG:
+                    control(false, [=](size_t l){ return static_cast<uint32_t>(vx[l] != vy[l]); });
+                    break;
+                case OP_LD_IMM:
+                    apply([=](size_t l, uint32_t m){ vx[l] = blend<uint8_t>(m, nn, vx[l]); });
+                    break;
+                case OP_ADD_IMM:
+                    apply([=](size_t l, uint32_t m){ vx[l] += blend<uint8_t>(m, nn, 0); });
+                    break;
+                case OP_LD_REG:
+                    apply([=](size_t l, uint32_t m){ vx[l] = blend<uint8_t>(m, vy[l], vx[l]); });
+                    break;
+                case OP_OR:
+                    apply([=](size_t l, uint32_t m){ vx[l] |= blend<uint8_t>(m, vy[l], 0); });
+                    break;
+                case OP_AND:
+                    apply([=](size_t l, uint32_t m){ vx[l] &= blend<uint8_t>(m, vy[l], 0xFF); });
+                    break;
+                case OP_XOR:
+                    apply([=](size_t l, uint32_t m){ vx[l] ^= blend<uint8_t>(m, vy[l], 0); });
+                    break;
+                case OP_ADD_REG:
+                    apply([=](size_t l, uint32_t m){
+                        uint16_t sum = static_cast<uint16_t>(vx[l]) + vy[l];
+                        vf[l] = blend<uint8_t>(m, sum > 0xFF, vf[l]);
+                        vx[l] = blend<uint8_t>(m, sum, vx[l]);
+                    });
+                    break;
+                case OP_SUB:
+                    apply([=](size_t l, uint32_t m){
+                        vf[l] = blend<uint8_t>(m, vx[l] >= vy[l], vf[l]);
+                        vx[l] = blend<uint8_t>(m, vx[l] - vy[l], vx[l]);
+                    });
+                    break;
+                case OP_SHR:
+                    apply([=](size_t l, uint32_t m){
+                        vf[l] = blend<uint8_t>(m, vx[l] & 0x1, vf[l]);
+                        vx[l] = blend<uint8_t>(m, vx[l] >> 1, vx[l]);
+                    });
+                    break;
+                case OP_SUBN:
+                    apply([=](size_t l, uint32_t m){
+                        vf[l] = blend<uint8_t>(m, vy[l] >= vx[l], vf[l]);
+                        vx[l] = blend<uint8_t>(m, vy[l] - vx[l], vx[l]);
+                    });
+                    break;
+                case OP_SHL:
+                    apply([=](size_t l, uint32_t m){
+                        vf[l] = blend<uint8_t>(m, vx[l] >> 7, vf[l]);
+                        vx[l] = blend<uint8_t>(m, vx[l] << 1, vx[l]);
+                    });
+                    break;
+                case OP_RND:
+                    // gerador de cada pista fica no Chip8 dela (o mesmo do nucleo escalar),
+                    // entao so o sorteio e pista a pista; o resto e o passo de controle
+                    control(false, [](size_t){ return 0u; });
+                    for (size_t l = 0; l < n; ++l){
+                        if (mask[l]){
+                            vx[l] = machines[l].getRandomByte() & nn;
+                        }
+                    }
+                    break;
+                case OP_LD_I:
+                    apply([=](size_t l, uint32_t m){ is[l] = blend<uint16_t>(m, nnn, is[l]); });
+                    break;
+                case OP_LD_VX_DT:
+                    apply([=](size_t l, uint32_t m){ vx[l] = blend<uint8_t>(m, dts[l], vx[l]); });
+                    break;
+                case OP_LD_DT_VX:
+                    apply([=](size_t l, uint32_t m){ dts[l] = blend<uint8_t>(m, vx[l], dts[l]); });
+                    break;
+                case OP_LD_ST_VX:
+                    apply([=](size_t l, uint32_t m){ sts[l] = blend<uint8_t>(m, vx[l], sts[l]); });
+                    break;
+                case OP_ADD_I_VX:
+                    apply([=](size_t l, uint32_t m){ is[l] += blend<uint16_t>(m, vx[l], 0); });
+                    break;
+                case OP_LD_F_VX:
+                    apply([=](size_t l, uint32_t m){
+                        is[l] = blend<uint16_t>(m, FONT_START_ADDRESS + (vx[l] & 0x0F) * FONT_CHARACTER_SIZE, is[l]);
+                    });
+                    break;
+                default:
+                    // sem caminho vetorial: o nucleo escalar em cada pista do grupo. pc e
+                    // orcamento ficam com o stepScalar; o laco principal refaz a varredura
+                    group.vector = false;
+                    for (size_t l = 0; l < n; ++l){
+                        const bool m = remaining[l] && pc[l] == at && code_id[l] == code && cleanAt(l, at);
+                        group.strays += remaining[l] && pc[l] == at && !m;
+                        mask[l] = m;
+                        if (m){
+                            ++group.size;
+                            stepScalar(l, in);
+                        }
+                    }
+                    break;
+            }
+            return group;
+        }
+};
+
+
+#endif // CHIP8_BATCH_H
@@ -0,0 +1,297 @@
+#ifndef DECODER_H
+#define DECODER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+
+// decodificador de instrucoes, usado pelo nucleo (chip8.h) e pelas ferramentas
+// (chip8-dis, chip8-recompile). Nao depende da maquina: so do opcode e da variante.
+
+
+
+// variantes da maquina; Chip8Machine<Variant> e especializada em tempo de compilacao
+struct ClassicChip8 {
+    static constexpr uint8_t ID = 0;
+    static constexpr const char* NAME = "chip8";
+    static constexpr unsigned int MEMORY_SIZE = 4096;
+    static constexpr unsigned int DISPLAY_WIDTH = 64;
+    static constexpr unsigned int DISPLAY_HEIGHT = 32;
+    static constexpr unsigned int DISPLAY_PLANES = 1;
+    static constexpr bool SUPER_CHIP = false; // 00CN, 00FB-00FF, DXY0, FX30, FX75/FX85
+    static constexpr bool XO_CHIP = false;    // 00DN, 5XY2/5XY3, F000 NNNN, FN01, F002, FX3A
+};
+
+struct SuperChip {
+    static constexpr uint8_t ID = 1;
+    static constexpr const char* NAME = "schip";
+    static constexpr unsigned int MEMORY_SIZE = 4096;
+    static constexpr unsigned int DISPLAY_WIDTH = 128;
+    static constexpr unsigned int DISPLAY_HEIGHT = 64;
+    static constexpr unsigned int DISPLAY_PLANES = 1;
+    static constexpr bool SUPER_CHIP = true;
+    static constexpr bool XO_CHIP = false;
+};
+
+struct XoChip {
+    static constexpr uint8_t ID = 2;
+    static constexpr const char* NAME = "xochip";
+    static constexpr unsigned int MEMORY_SIZE = 65536;
+    static constexpr unsigned int DISPLAY_WIDTH = 128;
+    static constexpr unsigned int DISPLAY_HEIGHT = 64;
+    static constexpr unsigned int DISPLAY_PLANES = 2;
+    static constexpr bool SUPER_CHIP = true;
+    static constexpr bool XO_CHIP = true;
+};
+
+
+// tipo de cada instrucao decodificada (indice na tabela de handlers)
+enum OpKind : uint8_t {
+    OP_UNDECODED = 0, // entrada do cache ainda nao decodificada
+    OP_INVALID,
+    OP_CLS, OP_RET, OP_SYS, OP_JP, OP_CALL,
+    OP_SE_IMM, OP_SNE_IMM, OP_SE_REG, OP_LD_IMM, OP_ADD_IMM,
+    OP_LD_REG, OP_OR, OP_AND, OP_XOR, OP_ADD_REG,
+    OP_SUB, OP_SHR, OP_SUBN, OP_SHL, OP_SNE_REG,
+    OP_LD_I, OP_JP_V0, OP_RND, OP_DRW, OP_SKP, OP_SKNP,
+    OP_LD_VX_DT, OP_LD_VX_K, OP_LD_DT_VX, OP_LD_ST_VX, OP_ADD_I_VX,
+    OP_LD_F_VX, OP_LD_B_VX, OP_LD_I_VX, OP_LD_VX_I,
+    // SUPER-CHIP
+    OP_SCD, OP_SCR, OP_SCL, OP_EXIT, OP_LOW, OP_HIGH, OP_LD_HF_VX, OP_LD_R_VX, OP_LD_VX_R,
+    // XO-CHIP
+    OP_SCU, OP_SAVE_RANGE, OP_LOAD_RANGE, OP_LD_I_LONG, OP_PLANE, OP_AUDIO, OP_PITCH,
+    OP_COUNT
+};
+
+// instrucao pre-decodificada: handler + operandos (N = nn & 0xF)
+struct DecodedInstr {
+    uint16_t opcode = 0;
+    uint16_t nnn = 0;
+    uint8_t op = OP_UNDECODED;
+    uint8_t x = 0;
+    uint8_t y = 0;
+    uint8_t nn = 0;
+};
+
+static_assert(sizeof(DecodedInstr) == 8, "DecodedInstr deve ter 8 bytes");
+
+// nome curto de cada OpKind, para relatorios (profiler)
+inline const char* opKindName(uint8_t op){
+    static const char* const NAMES[] = {
+        "undecoded", "invalid",
+        "00E0 cls", "00EE ret", "0NNN sys", "1NNN jp", "2NNN call",
+        "3XNN se", "4XNN sne", "5XY0 se", "6XNN ld", "7XNN add",
+        "8XY0 ld", "8XY1 or", "8XY2 and", "8XY3 xor", "8XY4 add",
+        "8XY5 sub", "8XY6 shr", "8XY7 subn", "8XYE shl", "9XY0 sne",
+        "ANNN ld i", "BNNN jp v0", "CXNN rnd", "DXYN drw", "EX9E skp", "EXA1 sknp",
+        "FX07 ld dt", "FX0A ld k", "FX15 ld dt", "FX18 ld st", "FX1E add i",
+        "FX29 ld f", "FX33 ld b", "FX55 ld [i]", "FX65 ld [i]",
+        "00CN scd", "00FB scr", "00FC scl", "00FD exit", "00FE low", "00FF high", "FX30 ld hf", "FX75 ld r", "FX85 ld r",
+        "00DN scu", "5XY2 save", "5XY3 load", "F000 ld i", "FN01 plane", "F002 audio", "FX3A pitch"
+    };
+    static_assert(sizeof(NAMES) / sizeof(NAMES[0]) == OP_COUNT, "um nome por OpKind");
+    return op < OP_COUNT ? NAMES[op] : "?";
+}
+
+const unsigned int MAX_BLOCK_LEN = 64; // instrucoes
+
+
+// decodifica um opcode em handler + operandos
+template <typename Variant>
+DecodedInstr decodeOpcode(uint16_t opcode){
+    DecodedInstr instr;
+    instr.opcode = opcode;
+    instr.nnn = opcode & 0x0FFF;
+    instr.nn = opcode & 0x00FF;
+    instr.x = (opcode & 0x0F00) >> 8;
+    instr.y = (opcode & 0x00F0) >> 4;
+    instr.op = OP_INVALID;
+
+    uint8_t N = opcode & 0x000F;
+
+    switch(opcode & 0xF000){
+        //00E0 (CLS), 00EE (RET)
+        case 0x0000:
+            switch(instr.nn){
+                case 0xE0: instr.op = OP_CLS; break;
+                case 0xEE: instr.op = OP_RET; break;
+                default:   instr.op = OP_SYS; break; // 0NNN: SYS, ignorada
+            }
+            if constexpr (Variant::SUPER_CHIP){
+                if (instr.x == 0){
+                    if ((instr.nn & 0xF0) == 0xC0) instr.op = OP_SCD;
+                    if (instr.nn == 0xFB) instr.op = OP_SCR;
+                    if (instr.nn == 0xFC) instr.op = OP_SCL;
+                    if (instr.nn == 0xFD) instr.op = OP_EXIT;
+                    if (instr.nn == 0xFE) instr.op = OP_LOW;
+                    if (instr.nn == 0xFF) instr.op = OP_HIGH;
+                }
+            }
+            if constexpr (Variant::XO_CHIP){
+                if (instr.x == 0 && (instr.nn & 0xF0) == 0xD0) instr.op = OP_SCU;
+            }
+            break;
+
+        case 0x1000: instr.op = OP_JP; break;
+        case 0x2000: instr.op = OP_CALL; break;
+        case 0x3000: instr.op = OP_SE_IMM; break;
+        case 0x4000: instr.op = OP_SNE_IMM; break;
+        case 0x5000:
+            if (N == 0) instr.op = OP_SE_REG;
+            if constexpr (Variant::XO_CHIP){
+                if (N == 2) instr.op = OP_SAVE_RANGE;
+                if (N == 3) instr.op = OP_LOAD_RANGE;
+            }
+            break;
+        case 0x6000: instr.op = OP_LD_IMM; break;
+        case 0x7000: instr.op = OP_ADD_IMM; break;
+
+        case 0x8000:
+            switch (N){
+                case 0x0: instr.op = OP_LD_REG; break;
+                case 0x1: instr.op = OP_OR; break;
+                case 0x2: instr.op = OP_AND; break;
+                case 0x3: instr.op = OP_XOR; break;
+                case 0x4: instr.op = OP_ADD_REG; break;
+                case 0x5: instr.op = OP_SUB; break;
+                case 0x6: instr.op = OP_SHR; break;
+                case 0x7: instr.op = OP_SUBN; break;
+                case 0xE: instr.op = OP_SHL; break;
+            }
+            break;
+
+        case 0x9000: if (N == 0) instr.op = OP_SNE_REG; break;
+        case 0xA000: instr.op = OP_LD_I; break;
+        case 0xB000: instr.op = OP_JP_V0; break;
+        case 0xC000: instr.op = OP_RND; break;
+        case 0xD000: instr.op = OP_DRW; break;
+
+        case 0xE000:
+            switch (instr.nn){
+                case 0x9E: instr.op = OP_SKP; break;
+                case 0xA1: instr.op = OP_SKNP; break;
+            }
+            break;
+
+        case 0xF000:
+            switch(instr.nn){
+                case 0x07: instr.op = OP_LD_VX_DT; break;
+                case 0x0A: instr.op = OP_LD_VX_K; break;
+                case 0x15: instr.op = OP_LD_DT_VX; break;
+                case 0x18: instr.op = OP_LD_ST_VX; break;
+                case 0x1E: instr.op = OP_ADD_I_VX; break;
+                case 0x29: instr.op = OP_LD_F_VX; break;
+                case 0x33: instr.op = OP_LD_B_VX; break;
+                case 0x55: instr.op = OP_LD_I_VX; break;
+                case 0x65: instr.op = OP_LD_VX_I; break;
+            }
+            if constexpr (Variant::SUPER_CHIP){
+                if (instr.nn == 0x30) instr.op = OP_LD_HF_VX;
+                if (instr.nn == 0x75) instr.op = OP_LD_R_VX;
+                if (instr.nn == 0x85) instr.op = OP_LD_VX_R;
+            }
+            if constexpr (Variant::XO_CHIP){
+                if (opcode == 0xF000) instr.op = OP_LD_I_LONG;
+                if (instr.nn == 0x01) instr.op = OP_PLANE;
+                if (opcode == 0xF002) instr.op = OP_AUDIO;
+                if (instr.nn == 0x3A) instr.op = OP_PITCH;
+            }
+            break;
+    }
+    return instr;
+}
+
+// instrucoes que encerram um bloco: desvios, skips, espera de tecla
+// e escritas na memoria (que podem invalidar o proprio codigo)
+inline bool endsBlock(uint8_t op){
+    switch (op){
+        case OP_RET: case OP_JP: case OP_CALL: case OP_JP_V0:
+        case OP_SE_IMM: case OP_SNE_IMM: case OP_SE_REG: case OP_SNE_REG:
+        case OP_SKP: case OP_SKNP:
+        case OP_LD_VX_K: case OP_LD_B_VX: case OP_LD_I_VX:
+        case OP_EXIT: case OP_SAVE_RANGE: case OP_LD_I_LONG: // F000 NNNN ocupa 4 bytes
+            return true;
+        default:
+            return false;
+    }
+}
+
+inline bool isSkip(uint8_t op){
+    return op == OP_SE_IMM || op == OP_SNE_IMM || op == OP_SE_REG || op == OP_SNE_REG || op == OP_SKP || op == OP_SKNP;
+}
+
+// escritas na memoria a partir de I
+inline bool isStore(uint8_t op){
+    return op == OP_LD_B_VX || op == OP_LD_I_VX || op == OP_SAVE_RANGE;
+}
+
+// tamanho em bytes: F000 NNNN leva o endereco na palavra seguinte
+inline unsigned int instrSize(uint8_t op){
+    return op == OP_LD_I_LONG ? 4 : 2;
+}
+
+// texto de uma instrucao no estilo de Cowgod ("LD V1, 0x05"); long_operand e a
+// palavra seguinte, usada so por F000 NNNN. Opcodes invalidos saem como "DW 0x1234".
+inline std::string formatInstr(const DecodedInstr& in, uint16_t long_operand = 0){
+    char text[32];
+    const unsigned int x = in.x, y = in.y, nn = in.nn, nnn = in.nnn, n = in.nn & 0xF;
+    switch (in.op){
+        case OP_CLS:       return "CLS";
+        case OP_RET:       return "RET";
+        case OP_SYS:       std::snprintf(text, sizeof(text), "SYS 0x%03X", nnn); break;
+        case OP_JP:        std::snprintf(text, sizeof(text), "JP 0x%03X", nnn); break;
+        case OP_CALL:      std::snprintf(text, sizeof(text), "CALL 0x%03X", nnn); break;
+        case OP_SE_IMM:    std::snprintf(text, sizeof(text), "SE V%X, 0x%02X", x, nn); break;
+        case OP_SNE_IMM:   std::snprintf(text, sizeof(text), "SNE V%X, 0x%02X", x, nn); break;
+        case OP_SE_REG:    std::snprintf(text, sizeof(text), "SE V%X, V%X", x, y); break;
+        case OP_LD_IMM:    std::snprintf(text, sizeof(text), "LD V%X, 0x%02X", x, nn); break;
+        case OP_ADD_IMM:   std::snprintf(text, sizeof(text), "ADD V%X, 0x%02X", x, nn); break;
+        case OP_LD_REG:    std::snprintf(text, sizeof(text), "LD V%X, V%X", x, y); break;
+        case OP_OR:        std::snprintf(text, sizeof(text), "OR V%X, V%X", x, y); break;
+        case OP_AND:       std::snprintf(text, sizeof(text), "AND V%X, V%X", x, y); break;
+        case OP_XOR:       std::snprintf(text, sizeof(text), "XOR V%X, V%X", x, y); break;
+        case OP_ADD_REG:   std::snprintf(text, sizeof(text), "ADD V%X, V%X", x, y); break;
+        case OP_SUB:       std::snprintf(text, sizeof(text), "SUB V%X, V%X", x, y); break;
+        case OP_SHR:       std::snprintf(text, sizeof(text), "SHR V%X", x); break;
+        case OP_SUBN:      std::snprintf(text, sizeof(text), "SUBN V%X, V%X", x, y); break;
+        case OP_SHL:       std::snprintf(text, sizeof(text), "SHL V%X", x); break;
+        case OP_SNE_REG:   std::snprintf(text, sizeof(text), "SNE V%X, V%X", x, y); break;
+        case OP_LD_I:      std::snprintf(text, sizeof(text), "LD I, 0x%03X", nnn); break;
+        case OP_JP_V0:     std::snprintf(text, sizeof(text), "JP V0, 0x%03X", nnn); break;
+        case OP_RND:       std::snprintf(text, sizeof(text), "RND V%X, 0x%02X", x, nn); break;
+        case OP_DRW:       std::snprintf(text, sizeof(text), "DRW V%X, V%X, %u", x, y, n); break;
+        case OP_SKP:       std::snprintf(text, sizeof(text), "SKP V%X", x); break;
+        case OP_SKNP:      std::snprintf(text, sizeof(text), "SKNP V%X", x); break;
+        case OP_LD_VX_DT:  std::snprintf(text, sizeof(text), "LD V%X, DT", x); break;
+        case OP_LD_VX_K:   std::snprintf(text, sizeof(text), "LD V%X, K", x); break;
+        case OP_LD_DT_VX:  std::snprintf(text, sizeof(text), "LD DT, V%X", x); break;
+        case OP_LD_ST_VX:  std::snprintf(text, sizeof(text), "LD ST, V%X", x); break;
+        case OP_ADD_I_VX:  std::snprintf(text, sizeof(text), "ADD I, V%X", x); break;
+        case OP_LD_F_VX:   std::snprintf(text, sizeof(text), "LD F, V%X", x); break;
+        case OP_LD_B_VX:   std::snprintf(text, sizeof(text), "LD B, V%X", x); break;
+        case OP_LD_I_VX:   std::snprintf(text, sizeof(text), "LD [I], V%X", x); break;
+        case OP_LD_VX_I:   std::snprintf(text, sizeof(text), "LD V%X, [I]", x); break;
+        case OP_SCD:       std::snprintf(text, sizeof(text), "SCD %u", n); break;
+        case OP_SCR:       return "SCR";
+        case OP_SCL:       return "SCL";
+        case OP_EXIT:      return "EXIT";
+        case OP_LOW:       return "LOW";
+        case OP_HIGH:      return "HIGH";
+        case OP_LD_HF_VX:  std::snprintf(text, sizeof(text), "LD HF, V%X", x); break;
+        case OP_LD_R_VX:   std::snprintf(text, sizeof(text), "LD R, V%X", x); break;
+        case OP_LD_VX_R:   std::snprintf(text, sizeof(text), "LD V%X, R", x); break;
+        case OP_SCU:       std::snprintf(text, sizeof(text), "SCU %u", n); break;
+        case OP_SAVE_RANGE: std::snprintf(text, sizeof(text), "SAVE V%X - V%X", x, y); break;
+        case OP_LOAD_RANGE: std::snprintf(text, sizeof(text), "LOAD V%X - V%X", x, y); break;
+        case OP_LD_I_LONG: std::snprintf(text, sizeof(text), "LD I, LONG 0x%04X", static_cast<unsigned int>(long_operand)); break;
+        case OP_PLANE:     std::snprintf(text, sizeof(text), "PLANE %u", x); break;
+        case OP_AUDIO:     return "AUDIO";
+        case OP_PITCH:     std::snprintf(text, sizeof(text), "PITCH V%X", x); break;
+        default:           std::snprintf(text, sizeof(text), "DW 0x%04X", static_cast<unsigned int>(in.opcode)); break;
+    }
+    return text;
+}
+
+
+#endif // DECODER_H
@@ -0,0 +1,365 @@
+// chip8-dis: desmonta ROMs e mostra o grafo de controle (decoder.h + analysis.h)
+//
+// uso:
+//   chip8-dis [--variant chip8|schip|xochip] rom.ch8              listagem por blocos
+//   chip8-dis [--variant chip8|schip|xochip] --dot rom.ch8         grafo de blocos (Graphviz)
+//   chip8-dis [--variant chip8|schip|xochip] --summary rom1.ch8 rom2.ch8 ...
+//   chip8-dis [--variant chip8|schip|xochip] --summary --rom-dir diretorio
+//
+// A analise e a mesma que o nucleo faz em predecodeProgram() e que o chip8-recompile
+// usa para cortar blocos. A listagem traz cada bloco basico com seus sucessores, as
+// sub-rotinas, os trechos de dados e os alertas: BNNN (destino desconhecido), ANNN
+// apontando para instrucoes (dado no codigo), instrucoes desalinhadas que se
+// sobrepoem, escritas sobre codigo (auto-modificavel) e execucao fora da ROM.
+// --summary imprime uma linha TSV por ROM, para varrer acervos inteiros.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "analysis.h"
+#include "chip8.h"
+
+
+enum class DisMode { Listing, Dot, Summary };
+
+struct DisOptions {
+    DisMode mode = DisMode::Listing;
+    std::vector<std::string> roms;
+};
+
+static bool readRom(const std::string& path, std::vector<uint8_t>& rom){
+    std::ifstream rom_file(path, std::ios::binary);
+    if (!rom_file.is_open()){
+        std::cerr << "Erro: nao foi possivel abrir a ROM: " << path << std::endl;
+        return false;
+    }
+    rom.assign(std::istreambuf_iterator<char>(rom_file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// o que a analise achou de estranho numa ROM, contado para --summary
+struct Findings {
+    size_t self_modifying = 0;  // escritas com I conhecido sobre codigo
+    size_t unknown_stores = 0;  // escritas com I desconhecido no bloco
+    size_t data_in_code = 0;    // ANNN apontando para instrucoes
+    size_t outside_rom = 0;     // blocos abaixo de START_ADDRESS e saidas pelo fim da ROM
+    size_t data_bytes = 0;      // bytes da ROM que nao sao codigo alcancavel
+};
+
+template <typename Variant>
+static Findings countFindings(const ProgramAnalysis<Variant>& analysis, size_t rom_size){
+    Findings findings;
+    for (const StoreSite& store : analysis.stores()){
+        findings.self_modifying += store.hits_code ? 1 : 0;
+        findings.unknown_stores += store.target < 0 ? 1 : 0;
+    }
+    for (const DataRef& ref : analysis.dataRefs()){
+        findings.data_in_code += ref.in_code ? 1 : 0;
+    }
+    for (const CodeBlock& block : analysis.blocks()){
+        findings.outside_rom += block.addr < START_ADDRESS ? 1 : 0;
+    }
+    findings.outside_rom += analysis.exits().size();
+    for (size_t addr = START_ADDRESS; addr < START_ADDRESS + rom_size; ++addr){
+        findings.data_bytes += analysis.isCode(addr) ? 0 : 1;
+    }
+    return findings;
+}
+
+template <typename Variant>
+static std::string blockLabel(const ProgramAnalysis<Variant>& analysis, size_t addr){
+    char label[16];
+    const char* kind = analysis.callSites(addr) > 0 ? "sub" : (analysis.blockAt(addr) >= 0 ? "bloco" : "end");
+    std::snprintf(label, sizeof(label), "%s_%03X", kind, static_cast<unsigned int>(addr));
+    return label;
+}
+
+template <typename Variant>
+static std::string instrText(const ProgramAnalysis<Variant>& analysis, size_t addr){
+    return formatInstr(analysis.decodeAt(addr), analysis.longOperand(addr));
+}
+
+// para onde o bloco segue, como comentario da ultima instrucao
+template <typename Variant>
+static std::string successorNote(const ProgramAnalysis<Variant>& analysis, const CodeBlock& block){
+    std::string note;
+    if (block.calls){
+        note = "chama " + blockLabel(analysis, block.call_target) + ", ";
+    }
+    if (block.last_op == OP_RET){
+        return "retorna";
+    }
+    if (block.last_op == OP_EXIT){
+        return "encerra";
+    }
+    if (block.last_op == OP_JP_V0){
+        return "destino desconhecido (BNNN)";
+    }
+    if (block.succ_count == 0){
+        return note + "sai da memoria";
+    }
+    note += block.calls ? "volta em" : "->";
+    for (unsigned int s = 0; s < block.succ_count; ++s){
+        note += " " + blockLabel(analysis, block.succ[s]);
+    }
+    return note;
+}
+
+template <typename Variant>
+static void printListing(const std::string& path, const std::vector<uint8_t>& rom, const ProgramAnalysis<Variant>& analysis){
+    const Findings findings = countFindings(analysis, rom.size());
+    std::printf("; %s: %s, %zu bytes\n", path.c_str(), Variant::NAME, rom.size());
+    std::printf("; %zu instrucoes em %zu blocos, %zu sub-rotinas, %zu bytes de dados\n",
+        analysis.instructions(), analysis.blocks().size(), analysis.subroutines().size(), findings.data_bytes);
+
+    std::printf(";\n; sub-rotinas:\n");
+    for (const Subroutine& sub : analysis.subroutines()){
+        std::printf(";   %s  %u chamada(s), %zu bloco(s), %s\n", blockLabel(analysis, sub.entry).c_str(),
+            sub.call_sites, sub.blocks.size(), sub.returns ? "retorna" : "nao retorna");
+    }
+    if (analysis.subroutines().empty()){
+        std::printf(";   (nenhuma)\n");
+    }
+
+    std::printf(";\n; alertas:\n");
+    size_t alerts = 0;
+    for (uint16_t addr : analysis.indirectJumps()){
+        std::printf(";   0x%03X  %s: destino desconhecido\n", addr, instrText(analysis, addr).c_str());
+        ++alerts;
+    }
+    for (const DataRef& ref : analysis.dataRefs()){
+        if (ref.in_code){
+            std::printf(";   0x%03X  %s aponta para codigo (dado no codigo)\n", ref.addr, instrText(analysis, ref.addr).c_str());
+            ++alerts;
+        }
+    }
+    for (const StoreSite& store : analysis.stores()){
+        if (store.hits_code){
+            std::printf(";   0x%03X  %s escreve em 0x%03X..0x%03X, sobre codigo (auto-modificavel)\n", store.addr,
+                instrText(analysis, store.addr).c_str(), static_cast<unsigned int>(store.target),
+                static_cast<unsigned int>(store.target + store.length - 1));
+            ++alerts;
+        }
+    }
+    for (uint16_t addr : analysis.overlaps()){
+        std::printf(";   0x%03X  instrucao sobreposta a de 0x%03X\n", addr + 1, addr);
+        ++alerts;
+    }
+    for (const CodeBlock& block : analysis.blocks()){
+        if (block.addr < START_ADDRESS){
+            std::printf(";   0x%03X  codigo antes da ROM\n", block.addr);
+            ++alerts;
+        }
+    }
+    for (uint16_t addr : analysis.exits()){
+        std::printf(";   0x%03X  a execucao passa do fim da ROM\n", addr);
+        ++alerts;
+    }
+    if (findings.unknown_stores > 0){
+        std::printf(";   %zu escrita(s) com I desconhecido no bloco\n", findings.unknown_stores);
+        ++alerts;
+    }
+    if (alerts == 0){
+        std::printf(";   (nenhum)\n");
+    }
+
+    const size_t rom_end = START_ADDRESS + rom.size();
+    int32_t block = -1;
+    for (size_t addr = 0; addr < ProgramAnalysis<Variant>::MEMORY_SIZE; ){
+        if (analysis.isLeader(addr)){
+            block = analysis.blockAt(addr);
+            std::printf("\n%s:%s\n", blockLabel(analysis, addr).c_str(), addr == START_ADDRESS ? "  ; entrada" : "");
+        }
+        if (analysis.isEntry(addr)){
+            const DecodedInstr in = analysis.decodeAt(addr);
+            std::string text = instrText(analysis, addr);
+            // ultima instrucao do bloco corrente: anota para onde ele segue
+            if (block >= 0 && analysis.blocks()[block].end == addr + instrSize(in.op)){
+                text.resize(std::max<size_t>(text.size(), 22), ' ');
+                text += "; " + successorNote(analysis, analysis.blocks()[block]);
+            }
+            if (in.op == OP_LD_I_LONG){
+                std::printf("    0x%03X  %04X %04X  %s\n", static_cast<unsigned int>(addr), in.opcode, analysis.longOperand(addr), text.c_str());
+            } else {
+                std::printf("    0x%03X  %04X       %s\n", static_cast<unsigned int>(addr), in.opcode, text.c_str());
+            }
+            ++addr;
+            continue;
+        }
+        if (addr >= START_ADDRESS && addr < rom_end && !analysis.isCode(addr)){
+            size_t end = addr;
+            while (end < rom_end && !analysis.isCode(end)){
+                ++end;
+            }
+            std::printf("\n; dados 0x%03X..0x%03X (%zu bytes)\n", static_cast<unsigned int>(addr), static_cast<unsigned int>(end - 1), end - addr);
+            while (addr < end){
+                // cada linha tem ate 8 bytes e recomeca onde um ANNN aponta
+                std::printf("    0x%03X ", static_cast<unsigned int>(addr));
+                const bool referenced = (analysis.flags(addr) & ProgramAnalysis<Variant>::BYTE_DATA_REF) != 0;
+                size_t row = 0;
+                do {
+                    std::printf(" %02X", rom[addr - START_ADDRESS]);
+                    ++addr;
+                    ++row;
+                } while (addr < end && row < 8 && !(analysis.flags(addr) & ProgramAnalysis<Variant>::BYTE_DATA_REF));
+                if (referenced){
+                    std::printf("%*s  ; <- ANNN", static_cast<int>(3 * (8 - row)), "");
+                }
+                std::printf("\n");
+            }
+            continue;
+        }
+        ++addr;
+    }
+}
+
+template <typename Variant>
+static void printDot(const std::string& path, const ProgramAnalysis<Variant>& analysis){
+    std::printf("digraph \"%s\" {\n", path.c_str());
+    std::printf("    node [shape=box fontname=\"monospace\" fontsize=10];\n");
+    for (const CodeBlock& block : analysis.blocks()){
+        const std::string name = blockLabel(analysis, block.addr);
+        std::string label = name + "\\l";
+        for (size_t addr = block.addr; addr < block.end; addr += instrSize(analysis.decodeAt(addr).op)){
+            char prefix[16];
+            std::snprintf(prefix, sizeof(prefix), "%03X  ", static_cast<unsigned int>(addr));
+            label += prefix + instrText(analysis, addr) + "\\l";
+        }
+        std::printf("    %s [label=\"%s\"%s];\n", name.c_str(), label.c_str(),
+            name.compare(0, 4, "sub_") == 0 ? " peripheries=2" : "");
+    }
+    for (const CodeBlock& block : analysis.blocks()){
+        const std::string name = blockLabel(analysis, block.addr);
+        for (unsigned int s = 0; s < block.succ_count; ++s){
+            std::printf("    %s -> %s;\n", name.c_str(), blockLabel(analysis, block.succ[s]).c_str());
+        }
+        if (block.calls && analysis.blockAt(block.call_target) >= 0){
+            std::printf("    %s -> %s [style=dashed];\n", name.c_str(), blockLabel(analysis, block.call_target).c_str());
+        }
+    }
+    std::printf("}\n");
+}
+
+template <typename Variant>
+static void printSummary(const std::string& path, size_t rom_size, const ProgramAnalysis<Variant>& analysis){
+    const Findings findings = countFindings(analysis, rom_size);
+    std::printf("%s\t%zu\t%zu\t%zu\t%zu\t%zu\t%zu\t%zu\t%zu\t%zu\t%zu\t%zu\n", path.c_str(), rom_size,
+        analysis.instructions(), analysis.blocks().size(), analysis.subroutines().size(),
+        analysis.indirectJumps().size(), findings.self_modifying, findings.unknown_stores,
+        findings.data_in_code, analysis.overlaps().size(), findings.outside_rom, findings.data_bytes);
+}
+
+template <typename Variant>
+static int runDis(const DisOptions& options){
+    // uma imagem e uma analise reaproveitadas para todas as ROMs
+    std::vector<uint8_t> image(Variant::MEMORY_SIZE);
+    ProgramAnalysis<Variant> analysis;
+    std::vector<uint8_t> rom;
+    std::chrono::steady_clock::duration analysis_time{};
+    size_t analyzed = 0;
+    int status = 0;
+
+    if (options.mode == DisMode::Summary){
+        std::printf("#rom\tbytes\tinstrucoes\tblocos\tsub-rotinas\tbnnn\tauto-mod\tescritas-i-desconhecido\tdado-no-codigo\tsobrepostas\tfora-da-rom\tbytes-de-dados\n");
+    }
+    for (const std::string& path : options.roms){
+        if (!readRom(path, rom)){
+            status = 1;
+            continue;
+        }
+        if (rom.size() > Variant::MEMORY_SIZE - START_ADDRESS){
+            std::cerr << "Erro: ROM grande demais para " << Variant::NAME << ": " << path << std::endl;
+            status = 1;
+            continue;
+        }
+        std::fill(image.begin(), image.end(), 0);
+        std::copy(rom.begin(), rom.end(), image.begin() + START_ADDRESS);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        analysis.analyze(image.data(), START_ADDRESS, START_ADDRESS + rom.size());
+        analysis_time += std::chrono::steady_clock::now() - start;
+        ++analyzed;
+
+        if (options.mode == DisMode::Listing){
+            printListing(path, rom, analysis);
+        } else if (options.mode == DisMode::Dot){
+            printDot(path, analysis);
+        } else {
+            printSummary(path, rom.size(), analysis);
+        }
+    }
+
+    if (options.mode == DisMode::Summary){
+        double ms = std::chrono::duration<double, std::milli>(analysis_time).count();
+        std::fprintf(stderr, "%zu ROMs analisadas em %.1f ms (%.1f us por ROM)\n",
+            analyzed, ms, analyzed > 0 ? 1000.0 * ms / analyzed : 0.0);
+    }
+    return status;
+}
+
+// todos os .ch8 do diretorio, em ordem alfabetica (como RomLibrary::addDirectory)
+static bool addDirectory(const std::string& directory, std::vector<std::string>& roms){
+    std::vector<std::string> paths;
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)){
+        if (it->is_regular_file() && it->path().extension() == ".ch8"){
+            paths.push_back(it->path().string());
+        }
+    }
+    if (error){
+        std::cerr << "Erro: nao foi possivel listar o diretorio: " << directory << std::endl;
+        return false;
+    }
+    std::sort(paths.begin(), paths.end());
+    roms.insert(roms.end(), paths.begin(), paths.end());
+    return true;
+}
+
+
+int main(int argc, char* argv[]){
+    DisOptions options;
+    std::string variant = ClassicChip8::NAME;
+
+    for (int i = 1; i < argc; ++i){
+        std::string arg = argv[i];
+        if (arg == "--variant" && i + 1 < argc){
+            variant = argv[++i];
+        } else if (arg == "--dot"){
+            options.mode = DisMode::Dot;
+        } else if (arg == "--summary"){
+            options.mode = DisMode::Summary;
+        } else if (arg == "--rom-dir" && i + 1 < argc){
+            if (!addDirectory(argv[++i], options.roms)){
+                return 1;
+            }
+        } else if (!arg.empty() && arg[0] == '-'){
+            std::cerr << "Argumento desconhecido: " << arg << std::endl;
+            return 1;
+        } else {
+            options.roms.push_back(arg);
+        }
+    }
+
+    if (options.roms.empty() || (options.mode != DisMode::Summary && options.roms.size() != 1)){
+        std::cerr << "Uso: " << argv[0] << " [--variant chip8|schip|xochip] [--dot] rom.ch8" << std::endl;
+        std::cerr << "     " << argv[0] << " [--variant chip8|schip|xochip] --summary (rom.ch8 ... | --rom-dir diretorio)" << std::endl;
+        return 1;
+    }
+
+    if (variant == ClassicChip8::NAME){
+        return runDis<ClassicChip8>(options);
+    }
+    if (variant == SuperChip::NAME){
+        return runDis<SuperChip>(options);
+    }
+    if (variant == XoChip::NAME){
+        return runDis<XoChip>(options);
+    }
+    std::cerr << "Variante desconhecida: " << variant << std::endl;
+    return 1;
+}
@@ -0,0 +1,127 @@
+#ifndef FORK_H
+#define FORK_H
+
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <memory>
+#include "chip8.h"
+
+
+// estado congelado de uma maquina, para buscas em arvore que ramificam muito.
+// A memoria (em paginas de 256 bytes) e a tela ficam em blocos imutaveis com contagem
+// de referencias, divididos entre todos os forks que nao os escreveram. Um fork custa
+// os registradores e um ponteiro por pagina; a memoria total cresce com o que os ramos
+// escreveram (FX33/FX55/5XY2, DXYN), nao com o numero de forks. Forks nao rodam
+// sozinhos: carregue num ForkRunner. Copiar um fork e barato e seguro entre threads.
+template <typename Machine>
+class MachineFork {
+    public:
+        typedef std::array<uint8_t, Machine::PAGE_SIZE> Page;
+        typedef typename Machine::DisplayBuffer DisplayBuffer;
+        typedef typename Machine::CpuState CpuState;
+
+        // vazio ate receber ForkRunner::fork()
+        bool isValid() const {
+            return display_buffer != nullptr;
+        }
+
+        // leitura direta, para avaliar um no da busca sem carregar
+        const CpuState& cpu() const {
+            return cpu_state;
+        }
+
+        const DisplayBuffer& display() const {
+            return *display_buffer;
+        }
+
+        uint8_t peek(size_t addr) const {
+            return (*pages[addr / Machine::PAGE_SIZE])[addr % Machine::PAGE_SIZE];
+        }
+
+        // bytes que so este fork segura (paginas e tela sem outro dono)
+        size_t exclusiveBytes() const {
+            size_t bytes = 0;
+            for (const std::shared_ptr<const Page>& page : pages){
+                if (page.use_count() == 1){
+                    bytes += sizeof(Page);
+                }
+            }
+            if (display_buffer.use_count() == 1){
+                bytes += sizeof(DisplayBuffer);
+            }
+            return bytes;
+        }
+
+    private:
+        template <typename> friend class ForkRunner;
+
+        std::array<std::shared_ptr<const Page>, Machine::MEMORY_PAGES> pages;
+        std::shared_ptr<const DisplayBuffer> display_buffer;
+        CpuState cpu_state;
+};
+
+
+// maquina de trabalho que roda forks. Lembra de que pagina veio cada trecho da sua
+// memoria: load() copia so as paginas que diferem do fork carregado (e invalida o
+// cache de decodificacao so nelas, o resto do codigo continua decodificado), e fork()
+// reaproveita as paginas que a CPU nao escreveu desde o ultimo load()/fork().
+// Escreva na memoria da maquina so pela CPU ou pelas cargas do Chip8Machine, que marcam
+// paginas sujas; escrita direta em memory[] passaria despercebida.
+template <typename Machine>
+class ForkRunner {
+    public:
+        typedef MachineFork<Machine> Fork;
+
+        // no heap: o cache de decodificacao do XO-CHIP passa de 500 KB
+        ForkRunner(): worker(new Machine()) {}
+
+        Machine& machine(){
+            return *worker;
+        }
+
+        Fork fork(){
+            Fork out;
+            for (size_t page = 0; page < Machine::MEMORY_PAGES; ++page){
+                if (!loaded[page] || worker->isPageDirty(page)){
+                    std::shared_ptr<typename Fork::Page> copy = std::make_shared<typename Fork::Page>();
+                    std::memcpy(copy->data(), &worker->memory[page * Machine::PAGE_SIZE], Machine::PAGE_SIZE);
+                    loaded[page] = copy;
+                }
+                out.pages[page] = loaded[page];
+            }
+            worker->clearDirtyPages();
+
+            if (!loaded_display || *loaded_display != worker->display_buffer){
+                loaded_display = std::make_shared<const typename Fork::DisplayBuffer>(worker->display_buffer);
+            }
+            out.display_buffer = loaded_display;
+            worker->saveCpuState(out.cpu_state);
+            return out;
+        }
+
+        void load(const Fork& from){
+            for (size_t page = 0; page < Machine::MEMORY_PAGES; ++page){
+                if (loaded[page] != from.pages[page] || worker->isPageDirty(page)){
+                    std::memcpy(&worker->memory[page * Machine::PAGE_SIZE], from.pages[page]->data(), Machine::PAGE_SIZE);
+                    worker->invalidateDecoded(page * Machine::PAGE_SIZE, Machine::PAGE_SIZE);
+                    loaded[page] = from.pages[page];
+                }
+            }
+            worker->clearDirtyPages();
+
+            // a tela pode ter mudado desde o ultimo load mesmo com o mesmo bloco: copia sempre
+            worker->display_buffer = *from.display_buffer;
+            worker->display_updated = true;
+            loaded_display = from.display_buffer;
+            worker->loadCpuState(from.cpu_state);
+        }
+
+    private:
+        std::unique_ptr<Machine> worker;
+        std::array<std::shared_ptr<const typename Fork::Page>, Machine::MEMORY_PAGES> loaded;
+        std::shared_ptr<const typename Fork::DisplayBuffer> loaded_display;
+};
+
+
+#endif // FORK_H
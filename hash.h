@@ -0,0 +1,22 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+#include <cstddef>
+
+
+const uint64_t FNV1A64_OFFSET = 0xcbf29ce484222325ULL;
+const uint64_t FNV1A64_PRIME = 0x100000001b3ULL;
+
+// FNV-1a 64 bits: rapido e suficiente para identificar framebuffers/ROMs
+inline uint64_t fnv1a64(const void* data, size_t size, uint64_t hash = FNV1A64_OFFSET){
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i){
+        hash ^= bytes[i];
+        hash *= FNV1A64_PRIME;
+    }
+    return hash;
+}
+
+
+#endif // HASH_H
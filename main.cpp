@@ -1,17 +1,40 @@
+#include <algorithm>
 #include <chrono>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_audio.h>
 #include <unordered_map>
 #include <thread>
+#include <atomic>
 #include <iostream>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <string>
+#include <memory>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <random>
 #include "chip8.h"
+#include "render.h"
+#include "rewind.h"
+#include "audio.h"
+#include "triple_buffer.h"
+#include "movie.h"
+#include "rom_library.h"
+#include "telemetry.h"
 
 
 const int AUDIO_FREQUENCY = 44100;
 const int AUDIO_SAMPLES = 1024;
 const int TONE_HZ = 440;
 const Sint16 AUDIO_AMPLITUDE = 3000; 
+const unsigned int TARGET_CPU_HZ = 700;
+const int KEY_WAIT_TIMEOUT_MS = 17; // um tick de 60 Hz, arredondado para cima
 const int SCREEN_SCALE = 25; // fator de escala
 const int SDL_WINDOW_WIDTH  =  DISPLAY_WIDTH * SCREEN_SCALE;
 const int SDL_WINDOW_HEIGHT =  DISPLAY_HEIGHT * SCREEN_SCALE;
@@ -21,47 +44,320 @@ const SDL_Color COLOR_BACKGROUND = {0, 0, 0, 255};       // Preto
 const SDL_Color COLOR_FOREGROUND = {255, 97, 0, 1};
 
 
-struct AudioState {
-    bool is_beeping = false;
-    double wave_pos = 0.0;
-    int samples_per_wave = 0;
-};
-
+// callback da SDL: so consome eventos do AudioSynth, nunca bloqueia o emulador
 void SDLCALL audioCallback (void* userdata, Uint8* stream, int len){
-    AudioState* audio_state = static_cast<AudioState*>(userdata);
-    Sint16* buffer = reinterpret_cast<Sint16*>(stream);
-    int length = len / sizeof(Sint16);
+    AudioSynth* synth = static_cast<AudioSynth*>(userdata);
+    synth->render(reinterpret_cast<Sint16*>(stream), len / sizeof(Sint16));
+}
+
+
+template <typename Machine>
+static bool saveStateToFile(const Machine& chip8_instance, const std::string& path){
+    std::vector<uint8_t> state;
+    chip8_instance.saveState(state);
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(state.data()), state.size());
+    return static_cast<bool>(file);
+}
 
-    if(audio_state == nullptr || audio_state->samples_per_wave == 0){
-        SDL_memset(stream, 0, len);
-        return;
+template <typename Machine>
+static bool loadStateFromFile(Machine& chip8_instance, const std::string& path){
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
     }
+    std::vector<uint8_t> state((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return chip8_instance.loadState(state.data(), state.size());
+}
+
+
+// comandos do thread SDL para o thread de emulacao
+enum class InputCommandType : uint8_t { KeyDown, KeyUp, SaveState, LoadState, RewindStart, RewindStop, TurboStart, TurboStop };
+
+struct InputCommand {
+    InputCommandType type;
+    uint8_t key;
+};
 
-    for(int i = 0; i < length; ++i){
-        if (audio_state->is_beeping){
-            buffer[i] = (audio_state->wave_pos < audio_state->samples_per_wave / 2.0) ? AUDIO_AMPLITUDE : -AUDIO_AMPLITUDE;
+
+// estado compartilhado entre o thread SDL e o thread de emulacao;
+// so a fila de entrada, o triple buffer e as flags atomicas cruzam threads
+template <typename Machine>
+struct EmulationContext {
+    Machine& chip8_instance;
+    ExecEngine engine;
+    std::string state_path;
+    AudioSynth& audio_synth;
+    MovieRecorder& movie; // aberto => grava as transicoes do teclado
+    unsigned int cpu_hz;
+    double speed;       // multiplicador do tempo real; 0 = sem limite
+    double turbo_speed; // enquanto Tab estiver pressionado
+
+    SpscRing<InputCommand, 256> input;
+    TripleBuffer<typename Machine::DisplayBuffer> frames;
+    std::atomic<bool> running{true};
+
+    // estatisticas lidas pelo thread SDL
+    std::atomic<uint64_t> executed_cycles{0};
+    std::atomic<uint64_t> emulated_frames{0};
+    std::atomic<uint64_t> idle_cycles{0}; // parte de executed_cycles pulada em lacos ociosos
+    std::atomic<bool> waiting_for_key{false}; // CPU parada em FX0A no fim do ultimo quadro
+
+    // telemetria do quadro emulado: gravada aqui, escrita em arquivo pelo thread SDL
+    LatencyHistogram input_time;    // esvaziar a fila de entrada
+    LatencyHistogram emulate_time;  // run() do quadro ou um passo de rebobinar
+    LatencyHistogram timers_time;   // audio do quadro (o tick dos timers ja vem de runUntilFrame)
+    LatencyHistogram snapshot_time; // snapshot do rebobinar e publicacao do quadro
+    LatencyHistogram busy_time;     // quadro inteiro, sem o sleep
+    LatencyHistogram tick_late;     // atraso do tick de 60 Hz em relacao ao horario marcado
+    std::atomic<uint64_t> resyncs{0}; // atrasou mais que max_lag e desistiu de recuperar
+
+    EmulationContext(Machine& machine, ExecEngine engine, const std::string& state_path, AudioSynth& audio_synth,
+                     MovieRecorder& movie, unsigned int cpu_hz, double speed, double turbo_speed)
+        : chip8_instance(machine), engine(engine), state_path(state_path), audio_synth(audio_synth),
+          movie(movie), cpu_hz(cpu_hz), speed(speed), turbo_speed(turbo_speed) {}
+};
+
+
+// thread de emulacao: roda a CPU em quadros de 1/60 s de tempo emulado, no ritmo do
+// proprio relogio (vezes a velocidade escolhida), e publica o framebuffer a cada quadro
+// em que ele mudou. Nunca espera o vsync nem o thread SDL; em turbo o thread SDL so
+// mostra o quadro mais recente e o resto e descartado no triple buffer.
+template <typename Machine>
+static void emulationLoop(EmulationContext<Machine>& ctx){
+    using Clock = std::chrono::steady_clock;
+    Machine& chip8_instance = ctx.chip8_instance;
+
+    const Clock::duration frame_interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / TIMER_HZ));
+    const Clock::duration max_lag = frame_interval * 15; // atrasou mais que isso (ex.: suspensao): nao tenta recuperar
+    Clock::time_point next_frame = Clock::now();
+    uint64_t frame = 0;
+
+    // --- save state / rebobinar ---
+    // F5 salva, F9 carrega, segurar Backspace rebobina (um frame por tick de 60 Hz)
+    RewindBuffer rewind_buffer;
+    std::vector<uint8_t> snapshot;
+    bool rewinding = false;
+    bool turbo = false;
+    bool fault_reported = false;
+
+    // --- audio ---
+    // tempo emulado em ciclos; as mudancas do beep vao carimbadas com ele para a thread de audio
+    uint64_t emulated_cycles = 0;
+    AudioEvent sent_audio = {};
+    auto audioState = [](const Machine& machine, uint64_t cycle) {
+        AudioEvent state = {};
+        state.cycle = cycle;
+        state.beeping = machine.getSoundTimer() > 0;
+        if constexpr (Machine::VariantType::XO_CHIP) {
+            state.use_pattern = 1;
+            state.pitch = machine.audio_pitch;
+            state.pattern = machine.audio_pattern;
+        }
+        return state;
+    };
+    auto audioChanged = [&](const AudioEvent& current) {
+        return current.beeping != sent_audio.beeping || current.pitch != sent_audio.pitch
+            || current.pattern != sent_audio.pattern;
+    };
+    // false com a fila cheia: fica pendente e vai de novo no proximo quadro
+    auto sendAudio = [&](const AudioEvent& current) {
+        bool changed = audioChanged(current);
+        if (changed && !ctx.audio_synth.push(current)) {
+            return false;
+        }
+        if (changed) {
+            sent_audio = current;
+        }
+        return true;
+    };
+
+    // Para carimbar cada mudanca no ciclo da instrucao que a fez (FX18, FX3A, F002), um
+    // quadro que termina com o som diferente e refeito instrucao a instrucao numa copia,
+    // a partir do snapshot do inicio dele (o mesmo do rebobinar) e das mesmas teclas. O
+    // resultado e o mesmo em qualquer motor; quadros sem mudanca nao custam nada a mais.
+    std::unique_ptr<Machine> audio_replay(new Machine());
+    audio_replay->setCpuHz(ctx.cpu_hz);
+    std::vector<InputCommand> frame_keys;
+    bool snapshot_is_frame_start = false; // snapshot == estado antes das teclas deste quadro
+    auto replayAudio = [&](uint64_t frame_start) {
+        if (!audio_replay->loadState(snapshot.data(), snapshot.size())) {
+            return false;
+        }
+        for (const InputCommand& command : frame_keys) {
+            if (command.type == InputCommandType::KeyDown) {
+                audio_replay->setKeyPressed(command.key);
+                audio_replay->handleKeyPressEvent(command.key);
+            } else {
+                audio_replay->setKeyReleased(command.key);
+            }
+        }
+        const uint64_t replay_start = audio_replay->cycleCount();
+        while (audio_replay->cycleCount() < chip8_instance.cycleCount()) {
+            audio_replay->runFor(1);
+            uint64_t at = frame_start + (audio_replay->cycleCount() - replay_start);
+            if (!sendAudio(audioState(*audio_replay, std::min(at, emulated_cycles)))) {
+                break;
+            }
+        }
+        return true;
+    };
+
+    while (ctx.running.load(std::memory_order_acquire)) {
+        Clock::time_point frame_start = Clock::now();
+        ctx.tick_late.record(frame_start > next_frame ? frame_start - next_frame : Clock::duration::zero());
+
+        // --- entrada vinda do thread SDL ---
+        InputCommand command;
+        frame_keys.clear();
+        while (ctx.input.pop(&command, 1) == 1) {
+            switch (command.type) {
+                case InputCommandType::KeyDown:
+                    frame_keys.push_back(command);
+                    ctx.movie.record(chip8_instance.cycleCount(), command.key, true);
+                    chip8_instance.setKeyPressed(command.key);
+                    chip8_instance.handleKeyPressEvent(command.key); // Notifica Fx0A
+                    break;
+                case InputCommandType::KeyUp:
+                    frame_keys.push_back(command);
+                    ctx.movie.record(chip8_instance.cycleCount(), command.key, false);
+                    chip8_instance.setKeyReleased(command.key);
+                    break;
+                case InputCommandType::SaveState:
+                    if (saveStateToFile(chip8_instance, ctx.state_path)) {
+                        std::cout << "Estado salvo em " << ctx.state_path << std::endl;
+                    } else {
+                        std::cerr << "Erro ao salvar estado em " << ctx.state_path << std::endl;
+                    }
+                    break;
+                case InputCommandType::LoadState:
+                    if (ctx.movie.isOpen()) {
+                        std::cerr << "Carregar estado desativado durante a gravacao do filme." << std::endl;
+                    } else if (loadStateFromFile(chip8_instance, ctx.state_path)) {
+                        rewind_buffer.clear();
+                        snapshot_is_frame_start = false;
+                        std::cout << "Estado carregado de " << ctx.state_path << std::endl;
+                    }
+                    break;
+                case InputCommandType::RewindStart:
+                    rewinding = !ctx.movie.isOpen(); // voltar no tempo quebraria a linha do tempo do filme
+                    break;
+                case InputCommandType::RewindStop:
+                    rewinding = false;
+                    break;
+                case InputCommandType::TurboStart:
+                    turbo = true;
+                    break;
+                case InputCommandType::TurboStop:
+                    turbo = false;
+                    break;
+            }
+        }
+
+        // --- um quadro de tempo emulado: ciclos da CPU ate o tick dos timers (60 Hz), no relogio da maquina ---
+        // o relogio do audio anda mesmo rebobinando, um quadro por volta, para nunca voltar
+        Clock::time_point input_done = Clock::now();
+        ctx.input_time.record(input_done - frame_start);
+        uint64_t frame_end = timerTickCycle(frame + 1, ctx.cpu_hz);
+        // CPU ja parada numa falha: o quadro so passa o tempo, e o snapshot nao guarda a falha
+        bool replay_audio = snapshot_is_frame_start && !rewinding && chip8_instance.fault == Fault::None;
+        if (rewinding) {
+            if (rewind_buffer.rewind(snapshot)) {
+                chip8_instance.loadState(snapshot.data(), snapshot.size());
+            }
         } else {
-            buffer[i] = 0;
+            const uint64_t frame_tick = chip8_instance.nextTickCycle();
+            RunResult run = chip8_instance.runUntilFrame(ctx.engine); // em espera de tecla o tempo so passa
+            ctx.executed_cycles.fetch_add(run.executed, std::memory_order_relaxed);
+            ctx.idle_cycles.fetch_add(run.idle, std::memory_order_relaxed);
+            if (run.fault != Fault::None && !fault_reported) {
+                // a CPU fica parada na instrucao; rebobinar ou carregar um estado a solta
+                std::fprintf(stderr, "Falha da CPU: %s em 0x%03X (opcode 0x%04X)\n", faultName(run.fault),
+                    chip8_instance.fault_pc, chip8_instance.fault_opcode);
+            }
+            if (chip8_instance.cycleCount() < frame_tick) {
+                chip8_instance.runUntilFrame(ctx.engine); // falhou no meio: o resto do quadro so passa o tempo
+            }
+            fault_reported = run.fault != Fault::None;
+        }
+        Clock::time_point emulate_done = Clock::now();
+        ctx.emulate_time.record(emulate_done - input_done);
+        const uint64_t frame_start_cycles = emulated_cycles;
+        emulated_cycles = frame_end;
+        ++frame;
+        ctx.emulated_frames.store(frame, std::memory_order_relaxed);
+        const AudioEvent frame_audio = audioState(chip8_instance, emulated_cycles);
+        if (audioChanged(frame_audio)) {
+            // sem snapshot do inicio do quadro (primeiro quadro, rebobinar, F9): no fim dele
+            if (!replay_audio || !replayAudio(frame_start_cycles)) {
+                sendAudio(frame_audio);
+            }
+        }
+        ctx.audio_synth.publish(emulated_cycles);
+        Clock::time_point timers_done = Clock::now();
+        ctx.timers_time.record(timers_done - emulate_done);
+        if (!rewinding) {
+            chip8_instance.saveState(snapshot);
+            rewind_buffer.push(snapshot);
         }
+        snapshot_is_frame_start = !rewinding;
 
-        audio_state->wave_pos += 1.0;
-        if(audio_state->wave_pos >= audio_state->samples_per_wave) {
-            audio_state->wave_pos -= audio_state->samples_per_wave;
+        // --- publica o quadro ---
+        if (chip8_instance.display_updated) {
+            ctx.frames.writeBuffer() = chip8_instance.display_buffer;
+            ctx.frames.publish();
+            chip8_instance.display_updated = false;
+        }
+        Clock::time_point now = Clock::now();
+        ctx.snapshot_time.record(now - timers_done);
+        ctx.busy_time.record(now - frame_start);
+        bool waiting_for_key = chip8_instance.isWaitingForKey() && !rewinding;
+        ctx.waiting_for_key.store(waiting_for_key, std::memory_order_relaxed);
+
+        // --- ritmo ---
+        // os timers continuam tickando por quadro emulado; so o intervalo real entre quadros muda.
+        // Rebobinar anda sempre em tempo real.
+        double current_speed = (turbo && !rewinding) ? ctx.turbo_speed : (rewinding ? 1.0 : ctx.speed);
+        if (waiting_for_key && current_speed <= 0.0) {
+            current_speed = 1.0; // sem limite e esperando tecla: so os timers andam, em tempo real basta
         }
+        if (current_speed <= 0.0) {
+            next_frame = now; // sem limite
+            continue;
+        }
+        next_frame += std::chrono::duration_cast<Clock::duration>(frame_interval / current_speed);
+        if (now - next_frame > max_lag) {
+            next_frame = now;
+            ctx.resyncs.fetch_add(1, std::memory_order_relaxed);
+        }
+        std::this_thread::sleep_until(next_frame);
     }
-
 }
 
 
-int main(int argc, char* argv[]){
-
-    if (argc != 2) {
-        std::cerr << "Uso: " << argv[0] << " <caminho_para_rom.ch8>" << std::endl;
-        return 1;
-    }
+struct EmulatorOptions {
+    std::string rom_path;
+    std::string trace_path;
+    std::string profile_path;
+    ExecEngine engine = ExecEngine::Interpreter;
+    bool force_software_renderer = false;
+    bool has_seed = false;
+    uint64_t seed = 0;
+    unsigned int cpu_hz = TARGET_CPU_HZ;
+    double speed = 1.0;       // 0 = sem limite
+    double turbo_speed = 0.0; // Tab pressionado; padrao sem limite
+    bool print_stats = false;
+    std::string movie_path; // --record
+    std::string telemetry_path;
+    double telemetry_interval = 10.0; // segundos entre amostras no arquivo
+};
 
-    std::string rom_path = argv[1];
 
+// frontend SDL para uma variante da maquina (Chip8, SUPER-CHIP ou XO-CHIP)
+template <typename Machine>
+static int runEmulator(const EmulatorOptions& options){
+    const std::string& rom_path = options.rom_path;
+    const ExecEngine engine = options.engine;
 
     //init sdl
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) != 0) { // init de video e audio
@@ -88,7 +384,10 @@ int main(int argc, char* argv[]){
 
     // -------- criação do renderer ----------
 
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    SDL_Renderer* renderer = nullptr;
+    if (!options.force_software_renderer) {
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    }
     if (!renderer) {
         std::cerr << "Erro ao criar renderizador SDL (tentando software fallback): " << SDL_GetError() << std::endl;
         // Fallback para renderizador de software se o acelerado falhar
@@ -101,12 +400,24 @@ int main(int argc, char* argv[]){
          }
     }
 
+    // framebuffer da variante (64x32 ou 128x64) vai para uma textura streaming; a escala fica com o SDL_RenderCopy
+    SDL_Texture* screen_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_STREAMING, Machine::DISPLAY_WIDTH, Machine::DISPLAY_HEIGHT);
+    if (!screen_texture) {
+        std::cerr << "Erro ao criar textura SDL: " << SDL_GetError() << std::endl;
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return 1;
+    }
+    const FramebufferExpander expander(
+        FramebufferExpander::packColor(COLOR_FOREGROUND.r, COLOR_FOREGROUND.g, COLOR_FOREGROUND.b),
+        FramebufferExpander::packColor(COLOR_BACKGROUND.r, COLOR_BACKGROUND.g, COLOR_BACKGROUND.b));
+
     std::cout << "SDL inicializado com sucesso." << std::endl;
     std::cout << "Janela: " << SDL_WINDOW_WIDTH << "x" << SDL_WINDOW_HEIGHT << " (Escala: " << SCREEN_SCALE << "x)" << std::endl;
 
 
-    AudioState audio_state;
-    audio_state.samples_per_wave = AUDIO_FREQUENCY / TONE_HZ;
+    AudioSynth audio_synth(AUDIO_FREQUENCY, options.cpu_hz, AUDIO_SAMPLES, TONE_HZ, AUDIO_AMPLITUDE);
 
     SDL_AudioSpec want, have;
     SDL_AudioDeviceID audio_device;
@@ -119,7 +430,7 @@ int main(int argc, char* argv[]){
     want.channels = 1;
     want.samples = AUDIO_SAMPLES;
     want.callback = audioCallback;
-    want.userdata = &audio_state;
+    want.userdata = &audio_synth;
 
     audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
 
@@ -136,14 +447,48 @@ int main(int argc, char* argv[]){
     }
 
     // --------- instancia chip8 ---------------
-    Chip8 chip8_instance;
+    // no heap: o cache de decodificacao do XO-CHIP (64 KB de memoria) passa de 500 KB
+    std::unique_ptr<Machine> machine(new Machine());
+    Machine& chip8_instance = *machine;
+    // sem --seed, uma semente nova por sessao (random_device so e consultado aqui)
+    const uint64_t seed = options.has_seed ? options.seed : std::random_device{}();
+    chip8_instance.seedRandom(seed);
+    chip8_instance.setCpuHz(options.cpu_hz);
+    std::cout << "Semente do gerador aleatorio: " << seed << std::endl;
     if (!chip8_instance.loadRom(rom_path)) {
         std::cerr << "Falha ao carregar a ROM. Encerrando." << std::endl;
+        SDL_DestroyTexture(screen_texture);
         SDL_DestroyRenderer(renderer);
         SDL_DestroyWindow(window);
         SDL_Quit();
         return 1; // Retorna erro se não conseguiu carregar
     }
+    std::cout << "ROM '" << rom_path << "' carregada em 0x" << std::hex << START_ADDRESS << std::dec << "." << std::endl;
+
+#ifdef CHIP8_TRACE
+    std::unique_ptr<Tracer> tracer;
+    if (!options.trace_path.empty()) {
+        tracer.reset(new Tracer());
+        if (!tracer->open(options.trace_path)) {
+            std::cerr << "Erro: nao foi possivel criar o arquivo de trace: " << options.trace_path << std::endl;
+            SDL_DestroyTexture(screen_texture);
+            SDL_DestroyRenderer(renderer);
+            SDL_DestroyWindow(window);
+            SDL_Quit();
+            return 1;
+        }
+        chip8_instance.tracer = tracer.get();
+        std::cout << "Trace binario gravando em " << options.trace_path << std::endl;
+    }
+#endif
+#ifdef CHIP8_PROFILE
+    std::unique_ptr<Profiler> profiler;
+    if (!options.profile_path.empty()) {
+        profiler.reset(new Profiler(Machine::MEMORY_SIZE));
+        chip8_instance.profiler = profiler.get();
+        std::cout << "Profiler ligado; relatorio em " << options.profile_path << " ao sair" << std::endl;
+    }
+#endif
 
 
     // --- keymap Teclado -> Tecla CHIP-8 ---
@@ -154,130 +499,399 @@ int main(int argc, char* argv[]){
         {SDLK_z, 0xA}, {SDLK_x, 0x0}, {SDLK_c, 0xB}, {SDLK_v, 0xF}  // Z X C V -> A 0 B F
     };
 
-    // --- config do tempo ---
-
-    using Clock = std::chrono::high_resolution_clock;
-    using TimePoint = std::chrono::time_point<Clock>;
-    using Duration = std::chrono::duration<double>;
-
-    const double TARGET_CPU_HZ = 700.0;
-    const Duration cpu_cycle_interval(1.0 / TARGET_CPU_HZ);
-    TimePoint last_cpu_cycle_time = Clock::now();
-    Duration cpu_time_accumulator = Duration(0.0);
+    // --- thread de emulacao ---
+    // --- gravacao de filme (entrada carimbada com o ciclo, repetivel no chip8-batch) ---
+    MovieRecorder movie;
+    if (!options.movie_path.empty()) {
+        MappedFile rom_file;
+        MovieHeader header;
+        header.variant = Machine::VariantType::ID;
+        header.rng = Machine::RngType::ID;
+        header.seed = seed;
+        header.cpu_hz = options.cpu_hz;
+        header.rom_hash = rom_file.open(rom_path) ? fnv1a64(rom_file.data(), rom_file.size()) : 0;
+        if (!movie.open(options.movie_path, header)) {
+            std::cerr << "Erro: nao foi possivel criar o filme: " << options.movie_path << std::endl;
+        } else {
+            std::cout << "Gravando filme em " << options.movie_path << " (rebobinar e F9 ficam desativados)" << std::endl;
+        }
+    }
 
-    const double TIMER_HZ = 60.0;
-    const Duration timer_interval(1.0 / TIMER_HZ);
-    TimePoint last_timer_update_time = Clock::now();
+    EmulationContext<Machine> ctx(chip8_instance, engine, rom_path + ".state", audio_synth, movie,
+                                  options.cpu_hz, options.speed, options.turbo_speed);
+    std::thread emulation_thread(emulationLoop<Machine>, std::ref(ctx));
 
+    auto forward = [&ctx](InputCommandType type, uint8_t key) {
+        InputCommand command = {type, key};
+        while (!ctx.input.push(command)) {
+            std::this_thread::yield(); // fila cheia: o thread de emulacao esvazia a cada quadro
+        }
+    };
 
 
-    // ---- loop principal -----
+    // ---- loop principal (SDL): eventos e apresentacao do quadro mais recente -----
 
     bool is_running = true;
     SDL_Event event;
 
-    while (is_running) {
-        TimePoint current_time = Clock::now();
-        Duration delta_time = current_time - last_cpu_cycle_time;
-        last_cpu_cycle_time = current_time;
-        cpu_time_accumulator += delta_time;
+    // --- estatisticas: quadros emulados/exibidos e MHz efetivo, uma vez por segundo ---
+    using StatsClock = std::chrono::steady_clock;
+    StatsClock::time_point stats_start = StatsClock::now();
+    uint64_t stats_cycles = 0;
+    uint64_t stats_frames = 0;
+    uint64_t presented_frames = 0;
+
+    // --- telemetria do thread SDL; o arquivo junta as duas threads a cada telemetry_interval ---
+    LatencyHistogram poll_time;   // esvaziar a fila de eventos da SDL
+    LatencyHistogram render_time; // expandir, copiar e apresentar um quadro (com vsync inclui a espera)
+    uint64_t missed_vsyncs = 0;   // retracos perdidos por voltas do loop mais longas que o periodo do monitor
+    SDL_DisplayMode display_mode;
+    const double refresh_hz = (SDL_GetWindowDisplayMode(window, &display_mode) == 0 && display_mode.refresh_rate > 0)
+        ? display_mode.refresh_rate : TIMER_HZ;
+    const StatsClock::duration refresh_period = std::chrono::duration_cast<StatsClock::duration>(std::chrono::duration<double>(1.0 / refresh_hz));
+
+    TelemetryFile telemetry;
+    if (!options.telemetry_path.empty()) {
+        if (telemetry.open(options.telemetry_path)) {
+            std::cout << "Telemetria gravando em " << options.telemetry_path << " a cada " << options.telemetry_interval << " s" << std::endl;
+        } else {
+            std::cerr << "Erro: nao foi possivel criar o arquivo de telemetria: " << options.telemetry_path << std::endl;
+        }
+    }
+    StatsClock::time_point telemetry_start = StatsClock::now();
+    uint64_t telemetry_cycles = 0;
+    uint64_t telemetry_idle = 0;
+    uint64_t telemetry_frames = 0;
+    uint64_t telemetry_presented = 0;
+    uint64_t telemetry_missed = 0;
+    uint64_t telemetry_resyncs = 0;
+    uint64_t total_presented = 0;
+    auto writeTelemetry = [&]() {
+        StatsClock::time_point now = StatsClock::now();
+        double elapsed = std::chrono::duration<double>(now - telemetry_start).count();
+        if (elapsed <= 0.0) {
+            return;
+        }
+        uint64_t cycles = ctx.executed_cycles.load(std::memory_order_relaxed);
+        uint64_t frames = ctx.emulated_frames.load(std::memory_order_relaxed);
+        uint64_t resyncs = ctx.resyncs.load(std::memory_order_relaxed);
+        uint64_t idle = ctx.idle_cycles.load(std::memory_order_relaxed);
+        telemetry.beginSample();
+        telemetry.writeValue("emu.ips", (cycles - telemetry_cycles) / elapsed);
+        telemetry.writeValue("emu.idle_pct", cycles > telemetry_cycles ? 100.0 * (idle - telemetry_idle) / (cycles - telemetry_cycles) : 0.0);
+        telemetry.writeValue("emu.tick_hz", (frames - telemetry_frames) / elapsed);
+        telemetry.writeValue("emu.resyncs", static_cast<double>(resyncs - telemetry_resyncs));
+        telemetry.writeHistogram("emu.input", ctx.input_time);
+        telemetry.writeHistogram("emu.emulate", ctx.emulate_time);
+        telemetry.writeHistogram("emu.timers", ctx.timers_time);
+        telemetry.writeHistogram("emu.snapshot", ctx.snapshot_time);
+        telemetry.writeHistogram("emu.busy", ctx.busy_time);
+        telemetry.writeHistogram("emu.tick_late", ctx.tick_late);
+        telemetry.writeValue("sdl.present_fps", (total_presented - telemetry_presented) / elapsed);
+        telemetry.writeValue("sdl.missed_vsyncs", static_cast<double>(missed_vsyncs - telemetry_missed));
+        telemetry.writeHistogram("sdl.poll", poll_time);
+        telemetry.writeHistogram("sdl.render", render_time);
+        telemetry.flush();
+        telemetry_start = now;
+        telemetry_cycles = cycles;
+        telemetry_idle = idle;
+        telemetry_frames = frames;
+        telemetry_presented = total_presented;
+        telemetry_missed = missed_vsyncs;
+        telemetry_resyncs = resyncs;
+    };
 
-        // --- eventos da SDL ---
-        while (SDL_PollEvent(&event)) {
-            switch (event.type) {
-                case SDL_QUIT: // evento de fechar a janela
+    // --- eventos da SDL: teclas viram comandos para o thread de emulacao ---
+    auto handleEvent = [&](const SDL_Event& event) {
+        switch (event.type) {
+            case SDL_QUIT: // evento de fechar a janela
+                is_running = false;
+                break;
+
+            case SDL_KEYDOWN: { // tecla pra baixo(pressionada)
+                SDL_Keycode key = event.key.keysym.sym;
+                // ESC pra sair
+                if (key == SDLK_ESCAPE) {
                     is_running = false;
                     break;
-                
-                case SDL_KEYDOWN: { // tecla pra baixo(pressionada)
-                    SDL_Keycode key = event.key.keysym.sym;
-                    // ESC pra sair
-                    if (key == SDLK_ESCAPE) {
-                        is_running = false;
-                        break;
-                    }
-                    // verifica se a tecla está mapeada
-                    auto it = keymap.find(key);
-                    if (it != keymap.end()) {
-                        uint8_t chip8_key = it->second;
-                        chip8_instance.setKeyPressed(chip8_key);
-                        chip8_instance.handleKeyPressEvent(chip8_key); // Notifica Fx0A
-                    }
+                }
+                if (key == SDLK_F5) {
+                    forward(InputCommandType::SaveState, 0);
                     break;
                 }
-                case SDL_KEYUP: { // tecla pra cima(tecla solta)
-                    SDL_Keycode key = event.key.keysym.sym;
-                    // Verifica se a tecla está mapeada
-                    auto it = keymap.find(key);
-                    if (it != keymap.end()) {
-                         uint8_t chip8_key = it->second;
-                         chip8_instance.setKeyReleased(chip8_key);
-                    }
+                if (key == SDLK_F9) {
+                    forward(InputCommandType::LoadState, 0);
+                    break;
+                }
+                if (key == SDLK_BACKSPACE) {
+                    forward(InputCommandType::RewindStart, 0);
+                    break;
+                }
+                if (key == SDLK_TAB) {
+                    forward(InputCommandType::TurboStart, 0);
+                    break;
+                }
+                // verifica se a tecla está mapeada
+                auto it = keymap.find(key);
+                if (it != keymap.end()) {
+                    forward(InputCommandType::KeyDown, it->second);
+                }
+                break;
+            }
+            case SDL_KEYUP: { // tecla pra cima(tecla solta)
+                SDL_Keycode key = event.key.keysym.sym;
+                if (key == SDLK_BACKSPACE) {
+                    forward(InputCommandType::RewindStop, 0);
                     break;
                 }
-            } // Fim do switch(event.type)
-        } // Fim do while(SDL_PollEvent)
+                if (key == SDLK_TAB) {
+                    forward(InputCommandType::TurboStop, 0);
+                    break;
+                }
+                // Verifica se a tecla está mapeada
+                auto it = keymap.find(key);
+                if (it != keymap.end()) {
+                    forward(InputCommandType::KeyUp, it->second);
+                }
+                break;
+            }
+        } // Fim do switch(event.type)
+    };
 
+    while (is_running) {
+        // --- eventos da SDL ---
+        StatsClock::time_point poll_start = StatsClock::now();
+        while (SDL_PollEvent(&event)) {
+            handleEvent(event);
+        }
+        StatsClock::time_point poll_done = StatsClock::now();
+        poll_time.record(poll_done - poll_start);
 
-        // atualizar timers (60 HZ) ---
-        Duration elapsed_since_last_timer = current_time - last_timer_update_time;
-        if (elapsed_since_last_timer >= timer_interval) {
-            chip8_instance.updateTimers();
-            bool should_beep_now = (chip8_instance.getSoundTimer() > 0);
-            if (audio_device != 0){
-                SDL_LockAudioDevice(audio_device);
+        // --- Renderizar Display ---
+        if (ctx.frames.update()) {
+            // expande o framebuffer direto na textura (uma passada com tabela)
+            void* pixels;
+            int pitch;
+            if (SDL_LockTexture(screen_texture, nullptr, &pixels, &pitch) == 0) {
+                expander.expand<Machine>(ctx.frames.readBuffer(), pixels, pitch);
+                SDL_UnlockTexture(screen_texture);
+            }
 
-                audio_state.is_beeping = should_beep_now;
+            SDL_RenderClear(renderer);
+            SDL_RenderCopy(renderer, screen_texture, nullptr, nullptr); // escala para a janela inteira
+            SDL_RenderPresent(renderer); // com vsync bloqueia so este thread
+            ++presented_frames;
+            ++total_presented;
+
+            StatsClock::time_point render_done = StatsClock::now();
+            render_time.record(render_done - poll_done);
+            // com vsync a volta leva ate um periodo; passou de 1,5 => perdeu pelo menos um retraco
+            uint64_t periods = static_cast<uint64_t>((render_done - poll_start + refresh_period / 2) / refresh_period);
+            if (periods > 1) {
+                missed_vsyncs += periods - 1;
+            }
+        } else if (ctx.waiting_for_key.load(std::memory_order_relaxed)) {
+            // CPU parada em FX0A: dorme ate um evento ou o proximo tick, quando pode haver quadro novo
+            if (SDL_WaitEventTimeout(&event, KEY_WAIT_TIMEOUT_MS)) {
+                handleEvent(event);
+            }
+        } else {
+            SDL_Delay(1); // nada novo: nao gira em falso
+        }
 
-                SDL_UnlockAudioDevice(audio_device);
+        double stats_elapsed = std::chrono::duration<double>(StatsClock::now() - stats_start).count();
+        if (stats_elapsed >= 1.0) {
+            uint64_t cycles = ctx.executed_cycles.load(std::memory_order_relaxed);
+            uint64_t frames = ctx.emulated_frames.load(std::memory_order_relaxed);
+            char stats[160];
+            std::snprintf(stats, sizeof(stats), "Emulador CHIP-8 C++ | %.0f quadros/s emulados | %.0f fps exibidos | %.3f MHz",
+                          (frames - stats_frames) / stats_elapsed, presented_frames / stats_elapsed,
+                          (cycles - stats_cycles) / stats_elapsed / 1e6);
+            SDL_SetWindowTitle(window, stats);
+            if (options.print_stats) {
+                std::cout << stats + std::strlen("Emulador CHIP-8 C++ | ") << std::endl;
             }
-            last_timer_update_time = last_timer_update_time + std::chrono::duration_cast<Clock::duration>(timer_interval);
+            stats_start = StatsClock::now();
+            stats_cycles = cycles;
+            stats_frames = frames;
+            presented_frames = 0;
+        }
+        if (telemetry.isOpen()
+            && std::chrono::duration<double>(StatsClock::now() - telemetry_start).count() >= options.telemetry_interval) {
+            writeTelemetry();
         }
 
+    }
+
+    ctx.running.store(false, std::memory_order_release);
+    emulation_thread.join();
+    if (telemetry.isOpen()) {
+        writeTelemetry(); // intervalo final, mesmo incompleto
+    }
 
+#ifdef CHIP8_PROFILE
+    if (profiler && !profiler->writeFiles(options.profile_path, opKindName)) {
+        std::cerr << "Erro: nao foi possivel gravar o relatorio do profiler: " << options.profile_path << std::endl;
+    }
+#endif
 
-        // --- executar os ciclos do chip-8  ---
-        // Controlado pela velocidade alvo (TARGET_CPU_HZ)
-        while (cpu_time_accumulator >= cpu_cycle_interval) {
-            chip8_instance.cycle();
-            cpu_time_accumulator -= cpu_cycle_interval;
+    // falhas nao fatais (opcode invalido, acesso fora da memoria...) so sao contadas
+    for (size_t kind = 1; kind < FAULT_KINDS; ++kind) {
+        if (chip8_instance.fault_counts[kind] > 0) {
+            std::cerr << "aviso: " << chip8_instance.fault_counts[kind] << "x " << faultName(static_cast<Fault>(kind)) << std::endl;
         }
+    }
 
+    if (audio_device != 0) {
+        SDL_CloseAudioDevice(audio_device);
+    }
+    SDL_DestroyTexture(screen_texture);
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return 0;
+}
 
-        // --- Renderizar Display ---
-        if (chip8_instance.display_updated) {
-            // Limpa a tela do renderizador com a cor de fundo
-            SDL_SetRenderDrawColor(renderer, COLOR_BACKGROUND.r, COLOR_BACKGROUND.g, COLOR_BACKGROUND.b, COLOR_BACKGROUND.a);
-            SDL_RenderClear(renderer);
 
-            // Define a cor para os pixels acesos
-            SDL_SetRenderDrawColor(renderer, COLOR_FOREGROUND.r, COLOR_FOREGROUND.g, COLOR_FOREGROUND.b, COLOR_FOREGROUND.a);
-
-            // Itera sobre o buffer CHIP-8
-            for (int y = 0; y < DISPLAY_HEIGHT; ++y) {
-                for (int x = 0; x < DISPLAY_WIDTH; ++x) {
-                    // Acessa o buffer diretamente (ou use getPixel)
-                    // Índice = x + y * Largura
-                    if (chip8_instance.display_buffer[x + y * DISPLAY_WIDTH]) {
-                         // Cria o retângulo escalado para o pixel CHIP-8
-                        SDL_Rect pixel_rect = {
-                            x * SCREEN_SCALE, // Posição X na janela
-                            y * SCREEN_SCALE, // Posição Y na janela
-                            SCREEN_SCALE,     // Largura do retângulo
-                            SCREEN_SCALE  
-                        };
-                        // Desenha o retângulo preenchido
-                        SDL_RenderFillRect(renderer, &pixel_rect);
-                    }
-                }
-            }
-            // Reseta a flag de atualização
-            chip8_instance.display_updated = false;
+// inteiro sem sinal ocupando o texto todo (strtoull sozinho aceitaria "-1", espacos e
+// lixo no fim); base 0 aceita tambem 0x... e 0...
+static bool parseUnsigned(const std::string& text, int base, unsigned long long& value) {
+    if (text.empty() || !std::isdigit(static_cast<unsigned char>(text[0]))) {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long parsed = std::strtoull(text.c_str(), &end, base);
+    if (*end != '\0' || errno == ERANGE) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// numero finito ocupando o texto todo
+static bool parseDouble(const std::string& text, double& value) {
+    if (text.empty() || std::isspace(static_cast<unsigned char>(text[0]))) {
+        return false;
+    }
+    char* end = nullptr;
+    double parsed = std::strtod(text.c_str(), &end);
+    if (*end != '\0' || !std::isfinite(parsed)) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// "max" (ou 0) = sem limite; -1 se nao for numero (recusado adiante como negativo)
+static double parseSpeed(const std::string& value){
+    double speed = 0.0;
+    if (value != "max" && !parseDouble(value, speed)) {
+        return -1.0;
+    }
+    return speed;
+}
+
+
+static void printUsage(const char* program) {
+    std::cerr << "Uso: " << program << " <caminho_para_rom.ch8> [--variant chip8|schip|xochip] [--engine interp|block] [--seed N] [--cpu-hz N] [--speed N|max] [--turbo N|max] [--stats] [--telemetry arquivo.txt] [--telemetry-interval s] [--record filme.c8mv] [--software] [--trace arquivo.c8tr] [--profile relatorio.txt]" << std::endl;
+}
+
 
-             // Atualiza a janela com o conteúdo do renderizador
-            SDL_RenderPresent(renderer);
+int main(int argc, char* argv[]){
+
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    EmulatorOptions options;
+    options.rom_path = argv[1];
+    std::string variant = ClassicChip8::NAME;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--trace" && i + 1 < argc) {
+            options.trace_path = argv[++i];
+        } else if (arg == "--profile" && i + 1 < argc) {
+            options.profile_path = argv[++i];
+        } else if (arg == "--software") {
+            options.force_software_renderer = true;
+        } else if (arg == "--seed" && i + 1 < argc) {
+            unsigned long long seed = 0;
+            if (!parseUnsigned(argv[++i], 0, seed)) {
+                std::cerr << "Semente invalida: " << argv[i] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+            options.has_seed = true;
+            options.seed = seed;
+        } else if (arg == "--cpu-hz" && i + 1 < argc) {
+            // fora do intervalo vira 0, recusado adiante
+            unsigned long long hz = 0;
+            options.cpu_hz = parseUnsigned(argv[++i], 10, hz) && hz <= UINT_MAX ? static_cast<unsigned int>(hz) : 0;
+        } else if (arg == "--speed" && i + 1 < argc) {
+            options.speed = parseSpeed(argv[++i]);
+        } else if (arg == "--turbo" && i + 1 < argc) {
+            options.turbo_speed = parseSpeed(argv[++i]);
+        } else if (arg == "--record" && i + 1 < argc) {
+            options.movie_path = argv[++i];
+        } else if (arg == "--telemetry" && i + 1 < argc) {
+            options.telemetry_path = argv[++i];
+        } else if (arg == "--telemetry-interval" && i + 1 < argc) {
+            if (!parseDouble(argv[++i], options.telemetry_interval)) {
+                options.telemetry_interval = 0.0; // recusado adiante
+            }
+        } else if (arg == "--stats") {
+            options.print_stats = true;
+        } else if (arg == "--variant" && i + 1 < argc) {
+            variant = argv[++i];
+        } else if (arg == "--engine" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "interp") {
+                options.engine = ExecEngine::Interpreter;
+            } else if (name == "block") {
+                options.engine = ExecEngine::Block;
+            } else {
+                std::cerr << "Motor desconhecido: " << name << " (use interp ou block)" << std::endl;
+                return 1;
+            }
+        } else {
+            std::cerr << "Argumento desconhecido: " << arg << std::endl;
+            return 1;
+        }
+    }
 
-        } // Fim do if(display_updated)
+    if (options.cpu_hz == 0 || options.speed < 0.0 || options.turbo_speed < 0.0) {
+        std::cerr << "Velocidade invalida: --cpu-hz deve ser um inteiro positivo e --speed/--turbo numeros nao negativos ou max." << std::endl;
+        return 1;
+    }
+    if (options.telemetry_interval <= 0.0) {
+        std::cerr << "Intervalo de telemetria invalido: --telemetry-interval deve ser um numero positivo de segundos." << std::endl;
+        return 1;
+    }
 
+#ifndef CHIP8_TRACE
+    if (!options.trace_path.empty()) {
+        std::cerr << "Trace indisponivel: recompile com 'make trace' (CHIP8_TRACE)." << std::endl;
+        return 1;
+    }
+#endif
+#ifndef CHIP8_PROFILE
+    if (!options.profile_path.empty()) {
+        std::cerr << "Profiler indisponivel: recompile com 'make profile' (CHIP8_PROFILE)." << std::endl;
+        return 1;
     }
-}
\ No newline at end of file
+#endif
+
+    // cada variante e uma instancia separada do nucleo, sem testes de modo em tempo de execucao
+    if (variant == ClassicChip8::NAME) {
+        return runEmulator<Chip8>(options);
+    } else if (variant == SuperChip::NAME) {
+        return runEmulator<Chip8Machine<SuperChip>>(options);
+    } else if (variant == XoChip::NAME) {
+        return runEmulator<Chip8Machine<XoChip>>(options);
+    }
+    std::cerr << "Variante desconhecida: " << variant << " (use chip8, schip ou xochip)" << std::endl;
+    return 1;
+}
@@ -0,0 +1,213 @@
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+// filme de entrada: todas as transicoes do teclado, carimbadas com o ciclo emulado,
+// para repetir uma sessao de forma deterministica.
+//
+// formato (little-endian):
+//   cabecalho: "C8MV" + versao (u16) + variante (u8) + gerador (u8) + semente (u64)
+//              + ciclos por segundo (u32) + hash FNV-1a da ROM (u64)
+//   seguido, ate o fim do arquivo, de um varint por transicao:
+//              (ciclos desde a anterior << 5) | (pressionada << 4) | tecla
+// O arquivo so cresce; um filme interrompido no meio continua legivel ate o ultimo registro inteiro.
+const char MOVIE_MAGIC[4] = {'C', '8', 'M', 'V'};
+const uint16_t MOVIE_VERSION = 1;
+const size_t MOVIE_HEADER_SIZE = sizeof(MOVIE_MAGIC) + 2 + 1 + 1 + 8 + 4 + 8;
+
+struct MovieHeader {
+    uint8_t variant = 0;
+    uint8_t rng = 0;
+    uint64_t seed = 0;
+    uint32_t cpu_hz = 0;
+    uint64_t rom_hash = 0;
+};
+
+struct MovieEvent {
+    uint64_t cycle;
+    uint8_t key;
+    bool pressed;
+};
+
+
+class MovieRecorder {
+    public:
+        MovieRecorder(): file(nullptr), last_cycle(0) {}
+
+        ~MovieRecorder(){
+            close();
+        }
+
+        bool open(const std::string& path, const MovieHeader& header){
+            close();
+            file = std::fopen(path.c_str(), "wb");
+            if (!file){
+                return false;
+            }
+            uint8_t bytes[MOVIE_HEADER_SIZE];
+            uint8_t* out = bytes;
+            std::memcpy(out, MOVIE_MAGIC, sizeof(MOVIE_MAGIC));
+            out += sizeof(MOVIE_MAGIC);
+            out = putLE(out, MOVIE_VERSION, 2);
+            *out++ = header.variant;
+            *out++ = header.rng;
+            out = putLE(out, header.seed, 8);
+            out = putLE(out, header.cpu_hz, 4);
+            putLE(out, header.rom_hash, 8);
+            std::fwrite(bytes, 1, sizeof(bytes), file);
+            last_cycle = 0;
+            return true;
+        }
+
+        bool isOpen() const {
+            return file != nullptr;
+        }
+
+        // transicoes devem vir em ordem de ciclo
+        void record(uint64_t cycle, uint8_t key, bool pressed){
+            if (!file){
+                return;
+            }
+            uint64_t delta = cycle >= last_cycle ? cycle - last_cycle : 0;
+            last_cycle += delta;
+            uint64_t value = (delta << 5) | (pressed ? 0x10 : 0) | (key & 0x0F);
+            uint8_t bytes[10];
+            size_t length = 0;
+            do {
+                uint8_t byte = value & 0x7F;
+                value >>= 7;
+                bytes[length++] = byte | (value ? 0x80 : 0);
+            } while (value);
+            std::fwrite(bytes, 1, length, file);
+        }
+
+        void close(){
+            if (file){
+                std::fclose(file);
+                file = nullptr;
+            }
+        }
+
+    private:
+        std::FILE* file;
+        uint64_t last_cycle;
+
+        static uint8_t* putLE(uint8_t* out, uint64_t value, int bytes){
+            for (int i = 0; i < bytes; ++i){
+                *out++ = static_cast<uint8_t>(value >> (8 * i));
+            }
+            return out;
+        }
+};
+
+
+// le o filme do disco aos poucos (um bloco por vez), nunca inteiro na memoria
+class MoviePlayer {
+    public:
+        MoviePlayer(): file(nullptr), chunk(CHUNK_SIZE), chunk_pos(0), chunk_len(0), last_cycle(0), has_next(false) {}
+
+        ~MoviePlayer(){
+            if (file){
+                std::fclose(file);
+            }
+        }
+
+        MoviePlayer(const MoviePlayer&) = delete;
+        MoviePlayer& operator=(const MoviePlayer&) = delete;
+
+        bool open(const std::string& path){
+            file = std::fopen(path.c_str(), "rb");
+            if (!file){
+                return false;
+            }
+            uint8_t bytes[MOVIE_HEADER_SIZE];
+            if (std::fread(bytes, 1, sizeof(bytes), file) != sizeof(bytes) || std::memcmp(bytes, MOVIE_MAGIC, sizeof(MOVIE_MAGIC)) != 0){
+                return false;
+            }
+            const uint8_t* in = bytes + sizeof(MOVIE_MAGIC);
+            if (getLE(in, 2) != MOVIE_VERSION){
+                return false;
+            }
+            header.variant = *in++;
+            header.rng = *in++;
+            header.seed = getLE(in, 8);
+            header.cpu_hz = static_cast<uint32_t>(getLE(in, 4));
+            header.rom_hash = getLE(in, 8);
+            advance();
+            return true;
+        }
+
+        const MovieHeader& getHeader() const {
+            return header;
+        }
+
+        // proxima transicao sem consumir; false no fim do filme
+        bool peek(MovieEvent& out) const {
+            if (has_next){
+                out = next;
+            }
+            return has_next;
+        }
+
+        void pop(){
+            advance();
+        }
+
+    private:
+        static const size_t CHUNK_SIZE = 64 * 1024;
+
+        std::FILE* file;
+        MovieHeader header;
+        std::vector<uint8_t> chunk;
+        size_t chunk_pos;
+        size_t chunk_len;
+        uint64_t last_cycle;
+        MovieEvent next;
+        bool has_next;
+
+        bool readByte(uint8_t& out){
+            if (chunk_pos == chunk_len){
+                chunk_len = std::fread(chunk.data(), 1, chunk.size(), file);
+                chunk_pos = 0;
+                if (chunk_len == 0){
+                    return false;
+                }
+            }
+            out = chunk[chunk_pos++];
+            return true;
+        }
+
+        void advance(){
+            uint64_t value = 0;
+            uint8_t byte = 0x80;
+            for (int shift = 0; byte & 0x80; shift += 7){
+                if (shift > 63 || !readByte(byte)){
+                    has_next = false; // fim (ou registro final incompleto)
+                    return;
+                }
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            }
+            last_cycle += value >> 5;
+            next.cycle = last_cycle;
+            next.pressed = (value & 0x10) != 0;
+            next.key = value & 0x0F;
+            has_next = true;
+        }
+
+        static uint64_t getLE(const uint8_t*& in, int bytes){
+            uint64_t value = 0;
+            for (int i = 0; i < bytes; ++i){
+                value |= static_cast<uint64_t>(*in++) << (8 * i);
+            }
+            return value;
+        }
+};
+
+
+#endif // MOVIE_H
@@ -0,0 +1,22 @@
+#ifndef NATIVE_H
+#define NATIVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "chip8.h"
+
+
+// interface da unidade de traducao gerada por chip8-recompile a partir de uma ROM.
+// Para usar: compile o .cpp gerado junto com o programa e
+//   chip8.attachNative(NATIVE_BLOCKS, NATIVE_BLOCK_COUNT);
+//   chip8.runFor(ciclos, ExecEngine::Native);
+// Os blocos conferem a memoria antes de rodar, entao anexar a outra ROM so deixa
+// tudo interpretado.
+
+extern const uint8_t NATIVE_ROM[];       // a ROM traduzida, para carregar com loadRomData()
+extern const size_t NATIVE_ROM_SIZE;
+extern const Chip8::NativeBlock NATIVE_BLOCKS[];
+extern const size_t NATIVE_BLOCK_COUNT;
+
+
+#endif // NATIVE_H
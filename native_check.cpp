@@ -0,0 +1,140 @@
+// chip8-native-check: confere o codigo gerado por chip8-recompile contra o interpretador
+//
+// uso (make native ROM=jogo.ch8 gera e liga native_rom.cpp):
+//   chip8-native-check [--cycles N] [--seed N] [--cpu-hz N] [--min-speedup X]
+//
+// Roda a ROM traduzida em duas maquinas, uma com ExecEngine::Interpreter e outra com
+// ExecEngine::Native, quadro a quadro (1/60 s de tempo emulado) ate o orcamento de
+// instrucoes, com as mesmas teclas pseudoaleatorias nas duas. Depois de cada quadro o
+// save state inteiro (tela, registradores, memoria, timers) tem de ser igual; na
+// primeira diferenca mostra o quadro e sai com status 1. Com estados iguais, o codigo
+// nativo ainda tem de rodar a pelo menos X vezes a velocidade do interpretador (padrao
+// 0.95, a margem do ruido de medida; 0 desliga), senao sai com status 2. Ciclos pulados
+// em laco ocioso custam o mesmo nos dois: uma ROM quase toda ociosa fica perto de 1x.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "chip8.h"
+#include "hash.h"
+#include "native.h"
+#include "rng.h"
+
+const uint64_t DEFAULT_CHECK_CYCLES = 10000000;
+const double DEFAULT_MIN_SPEEDUP = 0.95;
+
+
+static void describe(const char* name, const Chip8& chip8_instance){
+    std::fprintf(stderr, "  %-6s pc=0x%03X I=0x%03X sp=%u V=", name, chip8_instance.pc, chip8_instance.I, chip8_instance.sp);
+    for (uint8_t v : chip8_instance.V){
+        std::fprintf(stderr, "%02X", v);
+    }
+    std::fprintf(stderr, " tela=%016llx\n", static_cast<unsigned long long>(
+        fnv1a64(chip8_instance.display_buffer.data(), sizeof(chip8_instance.display_buffer))));
+}
+
+
+int main(int argc, char* argv[]){
+    uint64_t cycles = DEFAULT_CHECK_CYCLES;
+    uint64_t seed = DEFAULT_RANDOM_SEED;
+    unsigned int cpu_hz = DEFAULT_CPU_HZ;
+    double min_speedup = DEFAULT_MIN_SPEEDUP;
+    bool usage_error = false;
+
+    for (int i = 1; i < argc && !usage_error; ++i){
+        std::string arg = argv[i];
+        if (arg == "--cycles" && i + 1 < argc){
+            cycles = std::stoull(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc){
+            seed = std::stoull(argv[++i], nullptr, 0);
+        } else if (arg == "--cpu-hz" && i + 1 < argc){
+            cpu_hz = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else if (arg == "--min-speedup" && i + 1 < argc){
+            char* end = nullptr;
+            min_speedup = std::strtod(argv[++i], &end);
+            usage_error = end == argv[i] || *end != '\0' || !(min_speedup >= 0.0);
+        } else {
+            usage_error = true;
+        }
+    }
+    if (usage_error){
+        std::cerr << "Uso: " << argv[0] << " [--cycles N] [--seed N] [--cpu-hz N] [--min-speedup X]" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<Chip8> reference(new Chip8());
+    std::unique_ptr<Chip8> native(new Chip8());
+    for (Chip8* machine : {reference.get(), native.get()}){
+        machine->seedRandom(seed);
+        machine->setCpuHz(cpu_hz);
+        if (!machine->loadRomData(NATIVE_ROM, NATIVE_ROM_SIZE)){
+            std::cerr << "Erro: ROM traduzida grande demais." << std::endl;
+            return 1;
+        }
+    }
+    native->attachNative(NATIVE_BLOCKS, NATIVE_BLOCK_COUNT);
+
+    // teclado: a cada quadro, 1 chance em 8 de mudar uma tecla (e soltar um FX0A)
+    Pcg32Random keys;
+    keys.seed(seed);
+
+    std::chrono::steady_clock::duration reference_time{}, native_time{};
+    std::vector<uint8_t> reference_state, native_state;
+    uint64_t frame = 0;
+    uint64_t idle = 0;
+    while (reference->cycleCount() < cycles){
+        if (keys.nextByte() % 8 == 0){
+            uint8_t key = keys.nextByte() % 16;
+            bool down = keys.nextByte() & 1;
+            for (Chip8* machine : {reference.get(), native.get()}){
+                if (down){
+                    machine->setKeyPressed(key);
+                    machine->handleKeyPressEvent(key);
+                } else {
+                    machine->setKeyReleased(key);
+                }
+            }
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        RunResult reference_run = reference->runUntilFrame(ExecEngine::Interpreter);
+        std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+        RunResult native_run = native->runUntilFrame(ExecEngine::Native);
+        native_time += std::chrono::steady_clock::now() - middle;
+        reference_time += middle - start;
+        idle += native_run.idle;
+
+        reference->saveState(reference_state);
+        native->saveState(native_state);
+        if (reference_state != native_state || reference_run.executed != native_run.executed){
+            std::fprintf(stderr, "DIFERENCA no quadro %llu (ciclo %llu):\n",
+                static_cast<unsigned long long>(frame), static_cast<unsigned long long>(reference->cycleCount()));
+            describe("interp", *reference);
+            describe("native", *native);
+            return 1;
+        }
+
+        // falha fatal: as duas pararam iguais, nao ha mais o que comparar
+        if (reference_run.fault != Fault::None){
+            std::fprintf(stderr, "aviso: a ROM parou em %s (pc 0x%03X)\n", faultName(reference_run.fault), reference->fault_pc);
+            break;
+        }
+        ++frame;
+    }
+
+    double reference_s = std::chrono::duration<double>(reference_time).count();
+    double native_s = std::chrono::duration<double>(native_time).count();
+    double speedup = native_s > 0 ? reference_s / native_s : 0.0;
+    uint64_t total = reference->cycleCount();
+    std::printf("ok: %llu quadros, %llu ciclos (%.0f%% ociosos), estados iguais; interp %.3f s, native %.3f s (%.2fx)\n",
+        static_cast<unsigned long long>(frame), static_cast<unsigned long long>(total),
+        total > 0 ? 100.0 * idle / total : 0.0, reference_s, native_s, speedup);
+    if (native_s > 0 && speedup < min_speedup){
+        std::fprintf(stderr, "LENTO: native %.2fx o interpretador, minimo %.2fx\n", speedup, min_speedup);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,260 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// profiler do programa emulado (nao do emulador): onde a ROM gasta os ciclos.
+// So existe com CHIP8_PROFILE; a maquina chama os ganchos depois de cada
+// instrucao completada quando Chip8Machine::profiler != nullptr.
+//
+// coleta:
+//   - execucoes por tipo de instrucao (OpKind) e por endereco
+//   - arvore de chamadas montada com 2NNN/00EE (ciclos proprios por caminho)
+//   - saltos para tras (1NNN com destino <= origem) = lacos
+//   - DXYN por endereco e quantos colidiram (VF = 1)
+class Profiler {
+    public:
+        typedef const char* (*OpNameFn)(uint8_t op);
+
+        explicit Profiler(size_t memory_size): pc_counts(memory_size, 0), draws(0), collisions(0) {
+            op_counts.fill(0);
+            nodes.push_back(Node{0, ROOT, 0, 0});
+            path.push_back(ROOT);
+        }
+
+        // ---- ganchos da maquina ----
+
+        void onInstruction(uint16_t pc, uint8_t op){
+            ++op_counts[op];
+            ++pc_counts[pc];
+            ++nodes[path.back()].self;
+        }
+
+        // depth = sp depois do push; ressincroniza com a pilha real (save states, rebobinar)
+        void onCall(uint16_t target, unsigned int depth){
+            if (depth == 0){
+                return;
+            }
+            path.resize(std::min<size_t>(path.size(), depth));
+            uint32_t parent = path.back();
+            std::map<std::pair<uint32_t, uint16_t>, uint32_t>::const_iterator it = children.find(std::make_pair(parent, target));
+            uint32_t child;
+            if (it != children.end()){
+                child = it->second;
+            } else {
+                child = static_cast<uint32_t>(nodes.size());
+                nodes.push_back(Node{target, parent, 0, 0});
+                children[std::make_pair(parent, target)] = child;
+            }
+            ++nodes[child].calls;
+            path.push_back(child);
+        }
+
+        // depth = sp depois do pop
+        void onReturn(unsigned int depth){
+            path.resize(std::max<size_t>(1, std::min<size_t>(path.size(), depth + 1)));
+        }
+
+        void onJump(uint16_t from, uint16_t to){
+            if (to <= from){
+                ++loops[(static_cast<uint32_t>(to) << 16) | from];
+            }
+        }
+
+        void onDraw(uint16_t pc, bool collided){
+            ++draws;
+            collisions += collided ? 1 : 0;
+            ++draw_sites[pc];
+        }
+
+        // ---- relatorios ----
+
+        uint64_t totalInstructions() const {
+            uint64_t total = 0;
+            for (uint64_t count : op_counts){
+                total += count;
+            }
+            return total;
+        }
+
+        // texto: enderecos, sub-rotinas, lacos e tipos de instrucao mais quentes
+        void writeReport(std::ostream& out, OpNameFn op_name, size_t top = 20) const {
+            const uint64_t total = totalInstructions();
+            char line[160];
+            out << "instrucoes executadas: " << total << "\n";
+            if (total == 0){
+                return;
+            }
+
+            out << "\n== tipos de instrucao ==\n";
+            std::vector<std::pair<uint64_t, size_t>> ops;
+            for (size_t op = 0; op < op_counts.size(); ++op){
+                if (op_counts[op] > 0){
+                    ops.push_back(std::make_pair(op_counts[op], op));
+                }
+            }
+            std::sort(ops.rbegin(), ops.rend());
+            for (const std::pair<uint64_t, size_t>& op : ops){
+                std::snprintf(line, sizeof(line), "%-16s %14llu %6.2f%%\n", op_name(static_cast<uint8_t>(op.second)),
+                    static_cast<unsigned long long>(op.first), percent(op.first, total));
+                out << line;
+            }
+
+            out << "\n== enderecos mais quentes ==\n";
+            std::vector<std::pair<uint64_t, size_t>> hot;
+            for (size_t pc = 0; pc < pc_counts.size(); ++pc){
+                if (pc_counts[pc] > 0){
+                    hot.push_back(std::make_pair(pc_counts[pc], pc));
+                }
+            }
+            std::sort(hot.rbegin(), hot.rend());
+            for (size_t i = 0; i < hot.size() && i < top; ++i){
+                std::snprintf(line, sizeof(line), "0x%04zX %14llu %6.2f%%\n", hot[i].second,
+                    static_cast<unsigned long long>(hot[i].first), percent(hot[i].first, total));
+                out << line;
+            }
+
+            out << "\n== sub-rotinas (inclusivo) ==\n";
+            std::vector<uint64_t> inclusive = inclusiveCounts();
+            std::map<uint16_t, std::pair<uint64_t, uint64_t>> by_address; // endereco -> (ciclos, chamadas)
+            for (size_t i = 1; i < nodes.size(); ++i){
+                std::pair<uint64_t, uint64_t>& entry = by_address[nodes[i].address];
+                entry.second += nodes[i].calls;
+                if (!hasAncestorAt(static_cast<uint32_t>(i), nodes[i].address)){
+                    entry.first += inclusive[i]; // recursao nao conta duas vezes
+                }
+            }
+            std::vector<std::pair<std::pair<uint64_t, uint64_t>, uint16_t>> subs;
+            for (const std::pair<const uint16_t, std::pair<uint64_t, uint64_t>>& entry : by_address){
+                subs.push_back(std::make_pair(entry.second, entry.first));
+            }
+            std::sort(subs.rbegin(), subs.rend());
+            for (size_t i = 0; i < subs.size() && i < top; ++i){
+                std::snprintf(line, sizeof(line), "sub_%03X %14llu %6.2f%% %10llu chamadas\n", subs[i].second,
+                    static_cast<unsigned long long>(subs[i].first.first), percent(subs[i].first.first, total),
+                    static_cast<unsigned long long>(subs[i].first.second));
+                out << line;
+            }
+
+            out << "\n== lacos (saltos para tras) ==\n";
+            std::vector<std::pair<uint64_t, uint32_t>> hot_loops;
+            for (const std::pair<const uint32_t, uint64_t>& loop : loops){
+                hot_loops.push_back(std::make_pair(loop.second, loop.first));
+            }
+            std::sort(hot_loops.rbegin(), hot_loops.rend());
+            for (size_t i = 0; i < hot_loops.size() && i < top; ++i){
+                size_t start = hot_loops[i].second >> 16;
+                size_t end = hot_loops[i].second & 0xFFFF;
+                uint64_t body = 0; // instrucoes dentro de [inicio, salto]
+                for (size_t pc = start; pc <= end && pc < pc_counts.size(); ++pc){
+                    body += pc_counts[pc];
+                }
+                std::snprintf(line, sizeof(line), "0x%04zX-0x%04zX %12llu voltas %6.2f%%\n", start, end,
+                    static_cast<unsigned long long>(hot_loops[i].first), percent(body, total));
+                out << line;
+            }
+
+            out << "\n== desenho ==\n";
+            std::snprintf(line, sizeof(line), "DXYN: %llu, colisoes: %llu (%.2f%%)\n", static_cast<unsigned long long>(draws),
+                static_cast<unsigned long long>(collisions), percent(collisions, draws));
+            out << line;
+            std::vector<std::pair<uint64_t, uint16_t>> sites;
+            for (const std::pair<const uint16_t, uint64_t>& site : draw_sites){
+                sites.push_back(std::make_pair(site.second, site.first));
+            }
+            std::sort(sites.rbegin(), sites.rend());
+            for (size_t i = 0; i < sites.size() && i < top; ++i){
+                std::snprintf(line, sizeof(line), "0x%04X %14llu\n", sites[i].second, static_cast<unsigned long long>(sites[i].first));
+                out << line;
+            }
+        }
+
+        // pilhas "dobradas" (main;sub_2A4;sub_300 N), entrada do flamegraph.pl e similares
+        void writeFolded(std::ostream& out) const {
+            for (size_t i = 0; i < nodes.size(); ++i){
+                if (nodes[i].self == 0){
+                    continue;
+                }
+                out << stackName(static_cast<uint32_t>(i)) << ' ' << nodes[i].self << '\n';
+            }
+        }
+
+        // relatorio em path e pilhas dobradas em path + ".folded"
+        bool writeFiles(const std::string& path, OpNameFn op_name) const {
+            std::ofstream report(path);
+            std::ofstream folded(path + ".folded");
+            if (!report.is_open() || !folded.is_open()){
+                return false;
+            }
+            writeReport(report, op_name);
+            writeFolded(folded);
+            return report.good() && folded.good();
+        }
+
+    private:
+        static constexpr uint32_t ROOT = 0;
+
+        struct Node {
+            uint16_t address;  // destino da chamada (0 na raiz)
+            uint32_t parent;
+            uint64_t self;     // instrucoes executadas com este no no topo
+            uint64_t calls;
+        };
+
+        std::array<uint64_t, 256> op_counts;
+        std::vector<uint64_t> pc_counts;
+        std::vector<Node> nodes;
+        std::map<std::pair<uint32_t, uint16_t>, uint32_t> children;
+        std::vector<uint32_t> path; // caminho atual na arvore, raiz primeiro
+        std::map<uint32_t, uint64_t> loops; // (destino << 16 | origem) -> voltas
+        std::map<uint16_t, uint64_t> draw_sites;
+        uint64_t draws;
+        uint64_t collisions;
+
+        static double percent(uint64_t part, uint64_t whole){
+            return whole ? 100.0 * part / whole : 0.0;
+        }
+
+        // filhos sempre vem depois do pai no vetor, entao basta uma passada de tras pra frente
+        std::vector<uint64_t> inclusiveCounts() const {
+            std::vector<uint64_t> inclusive(nodes.size());
+            for (size_t i = 0; i < nodes.size(); ++i){
+                inclusive[i] = nodes[i].self;
+            }
+            for (size_t i = nodes.size() - 1; i > 0; --i){
+                inclusive[nodes[i].parent] += inclusive[i];
+            }
+            return inclusive;
+        }
+
+        bool hasAncestorAt(uint32_t node, uint16_t address) const {
+            for (uint32_t up = nodes[node].parent; up != ROOT; up = nodes[up].parent){
+                if (nodes[up].address == address){
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        std::string stackName(uint32_t node) const {
+            if (node == ROOT){
+                return "main";
+            }
+            char name[16];
+            std::snprintf(name, sizeof(name), ";sub_%03X", nodes[node].address);
+            return stackName(nodes[node].parent) + name;
+        }
+};
+
+
+#endif // PROFILE_H
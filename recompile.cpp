@@ -0,0 +1,250 @@
+// chip8-recompile: traduz uma ROM CHIP-8 classica para C++ antes da execucao
+//
+// uso:
+//   chip8-recompile rom.ch8 saida.cpp
+//
+// Segue o fluxo de controle a partir de START_ADDRESS com ProgramAnalysis (desvios,
+// chamadas, retornos de chamada e os dois lados de cada skip) e gera uma funcao por
+// bloco basico que opera direto sobre o estado de Chip8: as instrucoes de registrador
+// viram C++ em linha, o resto chama o handler do nucleo. O .cpp gerado inclui native.h
+// e liga com o mesmo chip8.h; rode com attachNative() + ExecEngine::Native. Destinos
+// de BNNN nao sao conhecidos aqui, e codigo auto-modificado nao bate mais com os
+// bytes traduzidos: nos dois casos o nucleo interpreta aquele trecho.
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+#include "analysis.h"
+#include "chip8.h"
+
+
+struct Block {
+    uint16_t addr;
+    uint8_t len;
+};
+
+// blocos a traduzir: os blocos basicos de ProgramAnalysis (analysis.h), cortados de
+// MAX_BLOCK_LEN em MAX_BLOCK_LEN instrucoes como o motor de blocos faria
+struct ControlFlow {
+    ProgramAnalysis<ClassicChip8> analysis;
+    std::vector<Block> blocks;
+};
+
+static DecodedInstr decodeAt(const Chip8& image, size_t addr){
+    return Chip8::decodeInstr(static_cast<uint16_t>(image.memory[addr] << 8) | image.memory[addr + 1]);
+}
+
+static void analyze(const Chip8& image, ControlFlow& flow){
+    flow.analysis.analyze(image.memory.data(), START_ADDRESS);
+    for (const CodeBlock& block : flow.analysis.blocks()){
+        for (unsigned int done = 0; done < block.instructions; done += MAX_BLOCK_LEN){
+            unsigned int len = std::min<unsigned int>(block.instructions - done, MAX_BLOCK_LEN);
+            flow.blocks.push_back(Block{static_cast<uint16_t>(block.addr + 2 * done), static_cast<uint8_t>(len)});
+        }
+    }
+}
+
+// C++ de uma instrucao no endereco addr; vazio se ela deve ir pelo handler do nucleo.
+// As de registrador repetem os handlers de chip8.h passo a passo (inclusive a ordem
+// das escritas em VF quando X ou Y e F).
+static std::string translate(const DecodedInstr& in, size_t addr){
+    char line[160];
+    const unsigned int x = in.x, y = in.y, nn = in.nn, nnn = in.nnn;
+    const unsigned int next = static_cast<unsigned int>(addr + 2), after = static_cast<unsigned int>(addr + 4);
+    switch (in.op){
+        case OP_SYS:
+            return "/* nada */";
+        case OP_JP:
+            std::snprintf(line, sizeof(line), "c.pc = 0x%03X;", nnn);
+            break;
+        case OP_SE_IMM:
+            std::snprintf(line, sizeof(line), "c.pc = c.V[0x%X] == 0x%02X ? 0x%03X : 0x%03X;", x, nn, after, next);
+            break;
+        case OP_SNE_IMM:
+            std::snprintf(line, sizeof(line), "c.pc = c.V[0x%X] != 0x%02X ? 0x%03X : 0x%03X;", x, nn, after, next);
+            break;
+        case OP_SE_REG:
+            std::snprintf(line, sizeof(line), "c.pc = c.V[0x%X] == c.V[0x%X] ? 0x%03X : 0x%03X;", x, y, after, next);
+            break;
+        case OP_SNE_REG:
+            std::snprintf(line, sizeof(line), "c.pc = c.V[0x%X] != c.V[0x%X] ? 0x%03X : 0x%03X;", x, y, after, next);
+            break;
+        case OP_LD_IMM:
+            std::snprintf(line, sizeof(line), "c.V[0x%X] = 0x%02X;", x, nn);
+            break;
+        case OP_ADD_IMM:
+            std::snprintf(line, sizeof(line), "c.V[0x%X] = static_cast<uint8_t>(c.V[0x%X] + 0x%02X);", x, x, nn);
+            break;
+        case OP_LD_REG:
+            std::snprintf(line, sizeof(line), "c.V[0x%X] = c.V[0x%X];", x, y);
+            break;
+        case OP_OR:
+            std::snprintf(line, sizeof(line), "c.V[0x%X] |= c.V[0x%X];", x, y);
+            break;
+        case OP_AND:
+            std::snprintf(line, sizeof(line), "c.V[0x%X] &= c.V[0x%X];", x, y);
+            break;
+        case OP_XOR:
+            std::snprintf(line, sizeof(line), "c.V[0x%X] ^= c.V[0x%X];", x, y);
+            break;
+        case OP_ADD_REG:
+            std::snprintf(line, sizeof(line), "{ unsigned int sum = c.V[0x%X] + c.V[0x%X]; c.V[0xF] = sum > 0xFF ? 1 : 0; c.V[0x%X] = static_cast<uint8_t>(sum); }", x, y, x);
+            break;
+        case OP_SUB:
+            std::snprintf(line, sizeof(line), "c.V[0xF] = c.V[0x%X] >= c.V[0x%X] ? 1 : 0; c.V[0x%X] = static_cast<uint8_t>(c.V[0x%X] - c.V[0x%X]);", x, y, x, x, y);
+            break;
+        case OP_SHR:
+            std::snprintf(line, sizeof(line), "c.V[0xF] = c.V[0x%X] & 0x1; c.V[0x%X] = static_cast<uint8_t>(c.V[0x%X] >> 1);", x, x, x);
+            break;
+        case OP_SUBN:
+            std::snprintf(line, sizeof(line), "c.V[0xF] = c.V[0x%X] >= c.V[0x%X] ? 1 : 0; c.V[0x%X] = static_cast<uint8_t>(c.V[0x%X] - c.V[0x%X]);", y, x, x, y, x);
+            break;
+        case OP_SHL:
+            std::snprintf(line, sizeof(line), "c.V[0xF] = (c.V[0x%X] & 0x80) >> 7; c.V[0x%X] = static_cast<uint8_t>(c.V[0x%X] << 1);", x, x, x);
+            break;
+        case OP_LD_I:
+            std::snprintf(line, sizeof(line), "c.I = 0x%03X;", nnn);
+            break;
+        case OP_LD_VX_DT:
+            std::snprintf(line, sizeof(line), "c.V[0x%X] = c.delay_timer;", x);
+            break;
+        case OP_LD_DT_VX:
+            std::snprintf(line, sizeof(line), "c.delay_timer = c.V[0x%X];", x);
+            break;
+        case OP_LD_ST_VX:
+            std::snprintf(line, sizeof(line), "c.sound_timer = c.V[0x%X];", x);
+            break;
+        case OP_ADD_I_VX:
+            std::snprintf(line, sizeof(line), "c.I = static_cast<uint16_t>(c.I + c.V[0x%X]);", x);
+            break;
+        default:
+            return std::string();
+    }
+    return line;
+}
+
+// instrucoes traduzidas em linha que ja deixam pc certo
+static bool setsPc(uint8_t op){
+    return op == OP_JP || op == OP_SE_IMM || op == OP_SNE_IMM || op == OP_SE_REG || op == OP_SNE_REG;
+}
+
+static void emitBytes(std::FILE* out, const uint8_t* data, size_t size){
+    for (size_t i = 0; i < size; ++i){
+        std::fprintf(out, i % 16 == 0 ? "\n    0x%02X," : " 0x%02X,", data[i]);
+    }
+    std::fprintf(out, "\n");
+}
+
+static void emitBlock(std::FILE* out, const Chip8& image, const Block& block){
+    std::fprintf(out, "const uint8_t code_%03X[] = {", block.addr);
+    emitBytes(out, &image.memory[block.addr], 2 * block.len);
+    std::fprintf(out, "};\n\n");
+
+    std::fprintf(out, "void block_%03X(Chip8& c){\n", block.addr);
+    bool pc_set = false;
+    for (unsigned int i = 0; i < block.len; ++i){
+        const size_t addr = block.addr + 2 * i;
+        const DecodedInstr in = decodeAt(image, addr);
+        std::fprintf(out, "    // 0x%03X: %04X  %s\n", static_cast<unsigned int>(addr), in.opcode, opKindName(in.op));
+        std::string code = translate(in, addr);
+        if (!code.empty()){
+            std::fprintf(out, "    %s\n", code.c_str());
+            pc_set = setsPc(in.op);
+        } else {
+            // handler do nucleo, com pc na instrucao seguinte como nos motores
+            std::fprintf(out, "    c.pc = 0x%03X;\n    Chip8::execute(c, DecodedInstr{0x%04X, 0x%03X, %u, 0x%X, 0x%X, 0x%02X});\n",
+                static_cast<unsigned int>(addr + 2), in.opcode, in.nnn, in.op, in.x, in.y, in.nn);
+            pc_set = true;
+        }
+    }
+    if (!pc_set){
+        std::fprintf(out, "    c.pc = 0x%03X;\n", static_cast<unsigned int>(block.addr + 2 * block.len));
+    }
+    std::fprintf(out, "}\n\n");
+}
+
+static bool writeTranslation(const std::string& path, const std::string& rom_path, const std::vector<uint8_t>& rom,
+                             const Chip8& image, const ControlFlow& flow){
+    std::FILE* out = std::fopen(path.c_str(), "w");
+    if (!out){
+        std::cerr << "Erro: nao foi possivel criar " << path << std::endl;
+        return false;
+    }
+
+    std::fprintf(out, "// gerado por chip8-recompile a partir de %s - nao edite\n", rom_path.c_str());
+    std::fprintf(out, "// %zu blocos, %zu instrucoes alcancaveis a partir de 0x%03X\n", flow.blocks.size(), flow.analysis.instructions(), START_ADDRESS);
+    if (!flow.analysis.indirectJumps().empty()){
+        std::fprintf(out, "// BNNN com destino desconhecido (interpretado):");
+        for (uint16_t addr : flow.analysis.indirectJumps()){
+            std::fprintf(out, " 0x%03X", addr);
+        }
+        std::fprintf(out, "\n");
+    }
+    std::fprintf(out, "#include \"native.h\"\n\n\n");
+
+    std::fprintf(out, "extern const uint8_t NATIVE_ROM[] = {");
+    if (rom.empty()){
+        std::fprintf(out, " 0 ");
+    } else {
+        emitBytes(out, rom.data(), rom.size());
+    }
+    std::fprintf(out, "};\nextern const size_t NATIVE_ROM_SIZE = %zu;\n\n", rom.size());
+
+    std::fprintf(out, "namespace {\n\n");
+    for (const Block& block : flow.blocks){
+        emitBlock(out, image, block);
+    }
+    std::fprintf(out, "} // namespace\n\n");
+
+    std::fprintf(out, "extern const Chip8::NativeBlock NATIVE_BLOCKS[] = {\n");
+    for (const Block& block : flow.blocks){
+        const size_t last = block.addr + 2 * (block.len - 1);
+        std::fprintf(out, "    {0x%03X, %u, %u, code_%03X, block_%03X},\n",
+            block.addr, block.len, decodeAt(image, last).op, block.addr, block.addr);
+    }
+    std::fprintf(out, "};\nextern const size_t NATIVE_BLOCK_COUNT = %zu;\n", flow.blocks.size());
+
+    bool ok = std::ferror(out) == 0;
+    ok = (std::fclose(out) == 0) && ok;
+    if (!ok){
+        std::cerr << "Erro: falha ao escrever " << path << std::endl;
+    }
+    return ok;
+}
+
+
+int main(int argc, char* argv[]){
+    if (argc != 3){
+        std::cerr << "Uso: " << argv[0] << " <rom.ch8> <saida.cpp>" << std::endl;
+        return 1;
+    }
+
+    std::ifstream rom_file(argv[1], std::ios::binary);
+    if (!rom_file.is_open()){
+        std::cerr << "Erro: nao foi possivel abrir a ROM: " << argv[1] << std::endl;
+        return 1;
+    }
+    std::vector<uint8_t> rom((std::istreambuf_iterator<char>(rom_file)), std::istreambuf_iterator<char>());
+
+    // imagem da memoria no power-on (fonte + ROM): e dela que o codigo e lido
+    std::unique_ptr<Chip8> image(new Chip8());
+    if (!image->loadRomData(rom.data(), rom.size())){
+        std::cerr << "Erro: ROM grande demais (" << rom.size() << " bytes)." << std::endl;
+        return 1;
+    }
+
+    ControlFlow flow;
+    analyze(*image, flow);
+    if (!writeTranslation(argv[2], argv[1], rom, *image, flow)){
+        return 1;
+    }
+
+    std::fprintf(stderr, "%zu blocos, %zu instrucoes traduzidas, %zu BNNN interpretados.\n",
+        flow.blocks.size(), flow.analysis.instructions(), flow.analysis.indirectJumps().size());
+    return 0;
+}
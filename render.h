@@ -0,0 +1,70 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include "chip8.h"
+
+
+// converte o framebuffer empacotado (1 bit por pixel por plano) em pixels 32 bits XRGB8888
+// com uma tabela: cada byte do framebuffer vira 8 pixels de uma vez
+class FramebufferExpander {
+    public:
+        // plane2/both so aparecem no XO-CHIP (pixel so no plano 2 / nos dois planos)
+        FramebufferExpander(uint32_t foreground, uint32_t background,
+                            uint32_t plane2 = 0xFF55AAFFu, uint32_t both = 0xFFFFFFFFu)
+            : palette{{background, foreground, plane2, both}} {
+            for (unsigned int byte = 0; byte < 256; ++byte){
+                for (unsigned int bit = 0; bit < 8; ++bit){
+                    table[byte][bit] = (byte & (0x80 >> bit)) ? foreground : background;
+                }
+            }
+        }
+
+        static uint32_t packColor(uint8_t r, uint8_t g, uint8_t b){
+            return 0xFF000000u | (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | b;
+        }
+
+        // escreve Machine::DISPLAY_WIDTH x DISPLAY_HEIGHT pixels; pitch em bytes, como devolvido por SDL_LockTexture
+        template <typename Machine>
+        void expand(const Machine& machine, void* pixels, int pitch) const {
+            expand<Machine>(machine.display_buffer, pixels, pitch);
+        }
+
+        // mesma coisa a partir de uma copia do framebuffer (ex.: quadro publicado por outra thread)
+        template <typename Machine>
+        void expand(const typename Machine::DisplayBuffer& display, void* pixels, int pitch) const {
+            const unsigned int plane_words = Machine::DISPLAY_HEIGHT * Machine::ROW_WORDS;
+            uint8_t* dst_row = static_cast<uint8_t*>(pixels);
+            for (unsigned int y = 0; y < Machine::DISPLAY_HEIGHT; ++y){
+                const uint64_t* row = &display[y * Machine::ROW_WORDS];
+                uint32_t* dst = reinterpret_cast<uint32_t*>(dst_row);
+                if constexpr (Machine::DISPLAY_PLANES == 1){
+                    for (unsigned int word = 0; word < Machine::ROW_WORDS; ++word){
+                        for (int shift = 56; shift >= 0; shift -= 8){
+                            std::memcpy(dst, table[(row[word] >> shift) & 0xFF].data(), 8 * sizeof(uint32_t));
+                            dst += 8;
+                        }
+                    }
+                } else {
+                    for (unsigned int x = 0; x < Machine::DISPLAY_WIDTH; ++x){
+                        uint64_t mask = 0x8000000000000000ULL >> (x % 64);
+                        unsigned int color = 0;
+                        for (unsigned int plane = 0; plane < Machine::DISPLAY_PLANES; ++plane){
+                            color |= (row[plane * plane_words + x / 64] & mask) ? (1u << plane) : 0;
+                        }
+                        *dst++ = palette[color & 3];
+                    }
+                }
+                dst_row += pitch;
+            }
+        }
+
+    private:
+        std::array<std::array<uint32_t, 8>, 256> table;
+        std::array<uint32_t, 4> palette;
+};
+
+
+#endif // RENDER_H
@@ -0,0 +1,180 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+
+// historico de save states para rebobinar: guarda o snapshot mais recente
+// inteiro e, para cada frame anterior, o XOR contra o seguinte comprimido
+// com RLE de zeros, num buffer circular de tamanho fixo
+class RewindBuffer {
+    public:
+        explicit RewindBuffer(size_t capacity_bytes = 4 * 1024 * 1024): ring(capacity_bytes), head(0) {}
+
+        // registra o snapshot de um frame
+        void push(const std::vector<uint8_t>& snapshot){
+            if (!current.empty()){
+                encodeDelta(current, snapshot, scratch);
+                store(scratch);
+            }
+            current = snapshot;
+        }
+
+        // volta um frame: devolve o snapshot anterior ao mais recente
+        bool rewind(std::vector<uint8_t>& snapshot){
+            if (entries.empty()){
+                return false;
+            }
+            Entry entry = entries.back();
+            entries.pop_back();
+            head = entry.offset; // o espaco volta a ficar livre
+
+            applyDelta(&ring[entry.offset], entry.size, current);
+            snapshot = current;
+            return true;
+        }
+
+        void clear(){
+            entries.clear();
+            current.clear();
+            head = 0;
+        }
+
+        size_t frames() const {
+            return entries.size();
+        }
+
+        size_t bytesUsed() const {
+            size_t total = 0;
+            for (const Entry& entry : entries){
+                total += entry.size;
+            }
+            return total;
+        }
+
+    private:
+        struct Entry {
+            size_t offset;
+            size_t size;
+        };
+
+        std::vector<uint8_t> ring;
+        size_t head;
+        std::deque<Entry> entries; // mais antigo primeiro
+        std::vector<uint8_t> current;
+        std::vector<uint8_t> scratch;
+
+        void store(const std::vector<uint8_t>& delta){
+            if (delta.size() > ring.size()){
+                entries.clear(); // nao cabe: historico recomeca daqui
+                head = 0;
+                return;
+            }
+            if (head + delta.size() > ring.size()){
+                // nao quebra registro no fim do buffer: volta ao inicio e
+                // descarta o que sobrou da volta anterior depois de head
+                while (!entries.empty() && entries.front().offset >= head){
+                    entries.pop_front();
+                }
+                head = 0;
+            }
+
+            // descarta os mais antigos que seriam sobrescritos
+            while (!entries.empty() && entries.front().offset < head + delta.size() && entries.front().offset + entries.front().size > head){
+                entries.pop_front();
+            }
+
+            std::copy(delta.begin(), delta.end(), ring.begin() + head);
+            entries.push_back(Entry{head, delta.size()});
+            head += delta.size();
+        }
+
+        static void putVarint(std::vector<uint8_t>& out, size_t value){
+            while (value >= 0x80){
+                out.push_back(static_cast<uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<uint8_t>(value));
+        }
+
+        static size_t getVarint(const uint8_t*& data){
+            size_t value = 0;
+            int shift = 0;
+            uint8_t byte;
+            do {
+                byte = *data++;
+                value |= static_cast<size_t>(byte & 0x7F) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+            return value;
+        }
+
+        // formato: tamanho de "older", depois pares (zeros, literais + bytes) ate cobrir o maior
+        static void encodeDelta(const std::vector<uint8_t>& older, const std::vector<uint8_t>& newer, std::vector<uint8_t>& out){
+            out.clear();
+            putVarint(out, older.size());
+
+            size_t length = older.size() > newer.size() ? older.size() : newer.size();
+            size_t i = 0;
+            while (i < length){
+                size_t zeros = 0;
+                while (i < length && xorAt(older, newer, i) == 0){
+                    ++zeros;
+                    ++i;
+                }
+                size_t literal_start = i;
+                // literal termina em uma sequencia de pelo menos 4 zeros
+                while (i < length){
+                    if (xorAt(older, newer, i) == 0){
+                        size_t run = 0;
+                        while (i + run < length && run < 4 && xorAt(older, newer, i + run) == 0){
+                            ++run;
+                        }
+                        if (run == 4 || i + run == length){
+                            break;
+                        }
+                        i += run;
+                    } else {
+                        ++i;
+                    }
+                }
+                putVarint(out, zeros);
+                putVarint(out, i - literal_start);
+                for (size_t j = literal_start; j < i; ++j){
+                    out.push_back(xorAt(older, newer, j));
+                }
+            }
+        }
+
+        // state (o mais novo) vira o anterior
+        static void applyDelta(const uint8_t* data, size_t size, std::vector<uint8_t>& state){
+            const uint8_t* end = data + size;
+            size_t older_size = getVarint(data);
+            if (state.size() < older_size){
+                state.resize(older_size, 0);
+            }
+
+            size_t i = 0;
+            while (data < end){
+                i += getVarint(data);
+                size_t literals = getVarint(data);
+                for (size_t j = 0; j < literals; ++j, ++i){
+                    state[i] ^= *data++;
+                }
+            }
+            state.resize(older_size);
+        }
+
+        static uint8_t xorAt(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, size_t i){
+            uint8_t va = i < a.size() ? a[i] : 0;
+            uint8_t vb = i < b.size() ? b[i] : 0;
+            return va ^ vb;
+        }
+};
+
+
+#endif // REWIND_H
@@ -0,0 +1,120 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+#include <cstddef>
+
+
+// geradores para CXNN, usados como politica por Chip8Machine<Variant, Rng>.
+// Interface: seed(), nextByte(), e o estado completo em STATE_SIZE bytes
+// (saveState/loadState) para o save state reproduzir a sequencia exata.
+const uint64_t DEFAULT_RANDOM_SEED = 0xC8C8C8C8ULL;
+
+
+// PCG32 (XSH RR): rapido, estado de 16 bytes, boa qualidade estatistica
+class Pcg32Random {
+    public:
+        static constexpr uint8_t ID = 1;
+        static constexpr const char* NAME = "pcg32";
+        static const size_t STATE_SIZE = 16;
+
+        Pcg32Random(){
+            seed(DEFAULT_RANDOM_SEED);
+        }
+
+        void seed(uint64_t value, uint64_t stream = 0xDA3E39CB94B95BDBULL){
+            state = 0;
+            increment = (stream << 1) | 1;
+            next();
+            state += value;
+            next();
+        }
+
+        uint8_t nextByte(){
+            return static_cast<uint8_t>(next() >> 24);
+        }
+
+        void saveState(uint8_t* out) const {
+            putLE(out, state);
+            putLE(out + 8, increment);
+        }
+
+        void loadState(const uint8_t* in){
+            state = getLE(in);
+            increment = getLE(in + 8) | 1;
+        }
+
+    private:
+        uint64_t state;
+        uint64_t increment; // sempre impar
+
+        uint32_t next(){
+            uint64_t old = state;
+            state = old * 6364136223846793005ULL + increment;
+            uint32_t xorshifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+            uint32_t rot = static_cast<uint32_t>(old >> 59);
+            return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+        }
+
+        static void putLE(uint8_t* out, uint64_t value){
+            for (int i = 0; i < 8; ++i){
+                out[i] = static_cast<uint8_t>(value >> (8 * i));
+            }
+        }
+
+        static uint64_t getLE(const uint8_t* in){
+            uint64_t value = 0;
+            for (int i = 0; i < 8; ++i){
+                value |= static_cast<uint64_t>(in[i]) << (8 * i);
+            }
+            return value;
+        }
+};
+
+
+// xorshift64*: o menor estado possivel (8 bytes), para quem quer so velocidade
+class XorShiftRandom {
+    public:
+        static constexpr uint8_t ID = 2;
+        static constexpr const char* NAME = "xorshift64*";
+        static const size_t STATE_SIZE = 8;
+
+        XorShiftRandom(){
+            seed(DEFAULT_RANDOM_SEED);
+        }
+
+        void seed(uint64_t value){
+            // splitmix64 espalha sementes pequenas; o estado nunca pode ser 0
+            uint64_t z = value + 0x9E3779B97F4A7C15ULL;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            state = (z ^ (z >> 31)) | 1;
+        }
+
+        uint8_t nextByte(){
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return static_cast<uint8_t>((state * 0x2545F4914F6CDD1DULL) >> 56);
+        }
+
+        void saveState(uint8_t* out) const {
+            for (int i = 0; i < 8; ++i){
+                out[i] = static_cast<uint8_t>(state >> (8 * i));
+            }
+        }
+
+        void loadState(const uint8_t* in){
+            state = 0;
+            for (int i = 0; i < 8; ++i){
+                state |= static_cast<uint64_t>(in[i]) << (8 * i);
+            }
+            state |= (state == 0); // estado 0 trava o gerador
+        }
+
+    private:
+        uint64_t state;
+};
+
+
+#endif // RNG_H
@@ -0,0 +1,251 @@
+#ifndef ROM_LIBRARY_H
+#define ROM_LIBRARY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "chip8.h"
+#include "hash.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+// arquivo mapeado em memoria, somente leitura
+class MappedFile {
+    public:
+        MappedFile() {}
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile(){
+            close();
+        }
+
+        bool open(const std::string& path){
+            close();
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE){
+                return false;
+            }
+            LARGE_INTEGER file_size;
+            if (!GetFileSizeEx(file, &file_size)){
+                close();
+                return false;
+            }
+            length = static_cast<size_t>(file_size.QuadPart);
+            if (length == 0){
+                return true; // arquivo vazio: nada para mapear
+            }
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping){
+                close();
+                return false;
+            }
+            bytes = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            if (!bytes){
+                close();
+                return false;
+            }
+#else
+            fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0){
+                return false;
+            }
+            struct stat info;
+            if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)){
+                close();
+                return false;
+            }
+            length = static_cast<size_t>(info.st_size);
+            if (length == 0){
+                return true;
+            }
+            void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view == MAP_FAILED){
+                close();
+                return false;
+            }
+            bytes = static_cast<const uint8_t*>(view);
+#endif
+            return true;
+        }
+
+        void close(){
+#ifdef _WIN32
+            if (bytes){
+                UnmapViewOfFile(bytes);
+            }
+            if (mapping){
+                CloseHandle(mapping);
+            }
+            if (file != INVALID_HANDLE_VALUE){
+                CloseHandle(file);
+            }
+            mapping = nullptr;
+            file = INVALID_HANDLE_VALUE;
+#else
+            if (bytes){
+                munmap(const_cast<uint8_t*>(bytes), length);
+            }
+            if (fd >= 0){
+                ::close(fd);
+            }
+            fd = -1;
+#endif
+            bytes = nullptr;
+            length = 0;
+        }
+
+        const uint8_t* data() const {
+            return bytes;
+        }
+
+        size_t size() const {
+            return length;
+        }
+
+    private:
+        const uint8_t* bytes = nullptr;
+        size_t length = 0;
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+#else
+        int fd = -1;
+#endif
+};
+
+
+// biblioteca de ROMs: mapeia cada arquivo uma vez, identifica pelo hash do conteudo
+// e guarda uma imagem pronta da maquina (ROM validada e carregada, instrucoes
+// pre-decodificadas, mapa de blocos basicos). Reiniciar uma instancia numa ROM e
+// Machine::loadProgram(*entry->image): so memcpy, sem sistema de arquivos.
+// Depois de montada e somente leitura, e pode ser compartilhada entre threads.
+template <typename Machine = Chip8>
+class RomLibrary {
+    public:
+        struct Entry {
+            std::string path;   // primeiro caminho em que o conteudo apareceu
+            std::string name;   // nome do arquivo sem diretorio nem extensao
+            uint64_t hash;      // FNV-1a do conteudo
+            std::shared_ptr<const MappedFile> file;
+            std::shared_ptr<const Machine> image;
+
+            const uint8_t* data() const {
+                return file->data();
+            }
+
+            size_t size() const {
+                return file->size();
+            }
+        };
+
+        // mapeia uma ROM; conteudo repetido (mesmo hash) reaproveita a entrada existente.
+        // nullptr se o arquivo nao abrir ou nao couber na memoria
+        const Entry* add(const std::string& path){
+            typename std::map<std::string, const Entry*>::const_iterator known = by_path.find(path);
+            if (known != by_path.end()){
+                return known->second;
+            }
+
+            std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+            if (!file->open(path)){
+                std::cerr << "Erro: Não foi possível abrir a ROM: " << path << std::endl;
+                return nullptr;
+            }
+            if (file->size() == 0){
+                std::cerr << "Erro: ROM vazia: " << path << std::endl;
+                return nullptr;
+            }
+            if (file->size() > Machine::MEMORY_SIZE - START_ADDRESS){
+                std::cerr << "Erro: ROM muito grande: " << path << std::endl;
+                return nullptr;
+            }
+
+            uint64_t hash = fnv1a64(file->data(), file->size());
+            typename std::map<uint64_t, std::unique_ptr<Entry>>::const_iterator same = by_hash.find(hash);
+            if (same != by_hash.end()){
+                by_path[path] = same->second.get();
+                return same->second.get();
+            }
+
+            std::unique_ptr<Machine> image(new Machine());
+            image->loadRomData(file->data(), file->size());
+            image->predecodeProgram(file->size());
+
+            std::unique_ptr<Entry> entry(new Entry());
+            entry->path = path;
+            entry->name = std::filesystem::path(path).stem().string();
+            entry->hash = hash;
+            entry->file = file;
+            entry->image = std::move(image);
+
+            const Entry* added = entry.get();
+            by_hash[hash] = std::move(entry);
+            by_path[path] = added;
+            order.push_back(added);
+            return added;
+        }
+
+        // mapeia todos os arquivos regulares com a extensao dada (ordem alfabetica);
+        // retorna quantos foram aceitos
+        size_t addDirectory(const std::string& directory, const std::string& extension = ".ch8"){
+            std::vector<std::string> paths;
+            std::error_code error;
+            for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)){
+                if (it->is_regular_file() && it->path().extension() == extension){
+                    paths.push_back(it->path().string());
+                }
+            }
+            if (error){
+                std::cerr << "Erro: Não foi possível listar o diretório: " << directory << std::endl;
+            }
+            std::sort(paths.begin(), paths.end());
+
+            size_t accepted = 0;
+            for (const std::string& path : paths){
+                accepted += add(path) ? 1 : 0;
+            }
+            return accepted;
+        }
+
+        const Entry* findByHash(uint64_t hash) const {
+            typename std::map<uint64_t, std::unique_ptr<Entry>>::const_iterator it = by_hash.find(hash);
+            return it != by_hash.end() ? it->second.get() : nullptr;
+        }
+
+        const Entry* findByPath(const std::string& path) const {
+            typename std::map<std::string, const Entry*>::const_iterator it = by_path.find(path);
+            return it != by_path.end() ? it->second : nullptr;
+        }
+
+        // entradas unicas, na ordem em que foram adicionadas
+        const std::vector<const Entry*>& entries() const {
+            return order;
+        }
+
+    private:
+        std::map<uint64_t, std::unique_ptr<Entry>> by_hash;
+        std::map<std::string, const Entry*> by_path;
+        std::vector<const Entry*> order;
+};
+
+
+#endif // ROM_LIBRARY_H
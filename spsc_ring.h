@@ -0,0 +1,56 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <cstddef>
+#include <vector>
+#include <atomic>
+
+
+// fila SPSC lock-free de tamanho fixo: uma thread produz, outra consome
+template <typename T, size_t CAPACITY>
+class SpscRing {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "capacidade deve ser potencia de 2");
+
+    public:
+        SpscRing(): buffer_(CAPACITY) {}
+
+        bool push(const T& item){
+            size_t head = head_.load(std::memory_order_relaxed);
+            if (head - tail_.load(std::memory_order_acquire) == CAPACITY){
+                return false; // cheia
+            }
+            buffer_[head & (CAPACITY - 1)] = item;
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // copia ate max itens para out, retorna quantos
+        size_t pop(T* out, size_t max){
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            size_t available = head_.load(std::memory_order_acquire) - tail;
+            size_t count = available < max ? available : max;
+            for (size_t i = 0; i < count; ++i){
+                out[i] = buffer_[(tail + i) & (CAPACITY - 1)];
+            }
+            tail_.store(tail + count, std::memory_order_release);
+            return count;
+        }
+
+        // primeiro item sem consumir; false se vazia
+        bool peek(T& out) const {
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            if (head_.load(std::memory_order_acquire) == tail){
+                return false;
+            }
+            out = buffer_[tail & (CAPACITY - 1)];
+            return true;
+        }
+
+    private:
+        std::vector<T> buffer_;
+        alignas(64) std::atomic<size_t> head_{0};
+        alignas(64) std::atomic<size_t> tail_{0};
+};
+
+
+#endif // SPSC_RING_H
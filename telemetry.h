@@ -0,0 +1,176 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+
+// histograma de duracoes com baldes fixos em potencias de 2 de microssegundos:
+// balde 0 = abaixo de 1 us, balde i = [2^(i-1), 2^i) us, o ultimo junta tudo acima de ~262 ms.
+// Um thread registra (record) e outro le (takeInterval) sem trava: os contadores so
+// crescem e o leitor guarda o que ja reportou, entao cada intervalo sai como diferenca.
+class LatencyHistogram {
+    public:
+        static const size_t BUCKETS = 20;
+
+        struct Interval {
+            uint64_t counts[BUCKETS];
+            uint64_t samples;
+            uint64_t sum_ns;
+
+            // limite superior (us) do balde onde cai o quantil q; 0 sem amostras
+            uint64_t percentileMicros(double q) const {
+                if (samples == 0){
+                    return 0;
+                }
+                uint64_t target = static_cast<uint64_t>(q * samples);
+                uint64_t seen = 0;
+                for (size_t b = 0; b < BUCKETS; ++b){
+                    seen += counts[b];
+                    if (seen > target){
+                        return upperMicros(b);
+                    }
+                }
+                return upperMicros(BUCKETS - 1);
+            }
+        };
+
+        LatencyHistogram(){
+            for (size_t b = 0; b < BUCKETS; ++b){
+                counts[b].store(0, std::memory_order_relaxed);
+                reported_counts[b] = 0;
+            }
+        }
+
+        // ---- escritor (um thread so) ----
+
+        void record(uint64_t nanoseconds){
+            uint64_t micros = nanoseconds / 1000;
+            size_t bucket = 0;
+            while (micros != 0 && bucket < BUCKETS - 1){
+                micros >>= 1;
+                ++bucket;
+            }
+            // escritor unico: load + store evita o prefixo lock do fetch_add
+            counts[bucket].store(counts[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            sum_ns.store(sum_ns.load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+        }
+
+        template <typename Duration>
+        void record(Duration elapsed){
+            record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+
+        // ---- leitor (um thread so) ----
+
+        // amostras desde a chamada anterior
+        void takeInterval(Interval& out){
+            out.samples = 0;
+            for (size_t b = 0; b < BUCKETS; ++b){
+                uint64_t total = counts[b].load(std::memory_order_relaxed);
+                out.counts[b] = total - reported_counts[b];
+                out.samples += out.counts[b];
+                reported_counts[b] = total;
+            }
+            uint64_t total_ns = sum_ns.load(std::memory_order_relaxed);
+            out.sum_ns = total_ns - reported_sum_ns;
+            reported_sum_ns = total_ns;
+        }
+
+        static uint64_t upperMicros(size_t bucket){
+            return uint64_t(1) << bucket;
+        }
+
+    private:
+        std::atomic<uint64_t> counts[BUCKETS];
+        std::atomic<uint64_t> sum_ns{0};
+        uint64_t reported_counts[BUCKETS];
+        uint64_t reported_sum_ns = 0;
+};
+
+
+// arquivo de estatisticas em texto, uma linha por metrica por amostra, para os paineis:
+//   <unix_ms> <nome> count=N sum_us=S p50_us=P p99_us=P buckets=c0,c1,...   (histograma)
+//   <unix_ms> <nome> value=V                                                (medida)
+// Os histogramas saem por intervalo (nao acumulados). Linhas com '#' sao comentarios.
+class TelemetryFile {
+    public:
+        TelemetryFile(): file(nullptr), timestamp_ms(0) {}
+
+        ~TelemetryFile(){
+            close();
+        }
+
+        bool open(const std::string& path){
+            close();
+            file = std::fopen(path.c_str(), "w");
+            if (!file){
+                return false;
+            }
+            std::fprintf(file, "# chip8-telemetry 1\n# buckets_us <1");
+            for (size_t b = 1; b < LatencyHistogram::BUCKETS - 1; ++b){
+                std::fprintf(file, " <%llu", static_cast<unsigned long long>(LatencyHistogram::upperMicros(b)));
+            }
+            std::fprintf(file, " >=%llu\n", static_cast<unsigned long long>(LatencyHistogram::upperMicros(LatencyHistogram::BUCKETS - 2)));
+            return true;
+        }
+
+        bool isOpen() const {
+            return file != nullptr;
+        }
+
+        // carimbo (relogio de parede) das linhas seguintes
+        void beginSample(){
+            timestamp_ms = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count());
+        }
+
+        void writeHistogram(const char* name, LatencyHistogram& histogram){
+            if (!file){
+                return;
+            }
+            LatencyHistogram::Interval interval;
+            histogram.takeInterval(interval);
+            std::fprintf(file, "%llu %s count=%llu sum_us=%llu p50_us=%llu p99_us=%llu buckets=",
+                static_cast<unsigned long long>(timestamp_ms), name,
+                static_cast<unsigned long long>(interval.samples),
+                static_cast<unsigned long long>(interval.sum_ns / 1000),
+                static_cast<unsigned long long>(interval.percentileMicros(0.50)),
+                static_cast<unsigned long long>(interval.percentileMicros(0.99)));
+            for (size_t b = 0; b < LatencyHistogram::BUCKETS; ++b){
+                std::fprintf(file, b == 0 ? "%llu" : ",%llu", static_cast<unsigned long long>(interval.counts[b]));
+            }
+            std::fputc('\n', file);
+        }
+
+        void writeValue(const char* name, double value){
+            if (file){
+                std::fprintf(file, "%llu %s value=%.3f\n", static_cast<unsigned long long>(timestamp_ms), name, value);
+            }
+        }
+
+        // fim da amostra: manda as linhas para o disco de uma vez
+        void flush(){
+            if (file){
+                std::fflush(file);
+            }
+        }
+
+        void close(){
+            if (file){
+                std::fclose(file);
+                file = nullptr;
+            }
+        }
+
+    private:
+        std::FILE* file;
+        uint64_t timestamp_ms;
+};
+
+
+#endif // TELEMETRY_H
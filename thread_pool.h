@@ -0,0 +1,135 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// pool com roubo de trabalho: cada worker tem sua fila, consome do fim
+// da propria e rouba do inicio das filas dos outros quando fica sem tarefa
+class WorkStealingPool {
+    public:
+        using Task = std::function<void()>;
+
+        explicit WorkStealingPool(unsigned int num_threads = 0): pending(0), stopping(false), next_queue(0) {
+            if (num_threads == 0){
+                num_threads = std::thread::hardware_concurrency();
+                if (num_threads == 0){
+                    num_threads = 1;
+                }
+            }
+
+            for (unsigned int i = 0; i < num_threads; ++i){
+                queues.emplace_back(new WorkQueue());
+            }
+            for (unsigned int i = 0; i < num_threads; ++i){
+                threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+            }
+        }
+
+        ~WorkStealingPool(){
+            {
+                std::lock_guard<std::mutex> lock(idle_mutex);
+                stopping = true;
+            }
+            idle_cv.notify_all();
+            for (std::thread& t : threads){
+                t.join();
+            }
+        }
+
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        unsigned int size() const {
+            return static_cast<unsigned int>(threads.size());
+        }
+
+        // distribui as tarefas em round-robin entre as filas
+        void submit(Task task){
+            pending.fetch_add(1, std::memory_order_relaxed);
+            size_t index = next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+            {
+                std::lock_guard<std::mutex> lock(queues[index]->mutex);
+                queues[index]->tasks.push_back(std::move(task));
+            }
+            idle_cv.notify_one();
+        }
+
+        // bloqueia ate todas as tarefas submetidas terminarem
+        void wait(){
+            std::unique_lock<std::mutex> lock(idle_mutex);
+            done_cv.wait(lock, [this]{ return pending.load(std::memory_order_acquire) == 0; });
+        }
+
+    private:
+        struct WorkQueue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<WorkQueue>> queues;
+        std::vector<std::thread> threads;
+        std::atomic<size_t> pending;
+        bool stopping;
+        std::atomic<size_t> next_queue;
+
+        std::mutex idle_mutex;
+        std::condition_variable idle_cv;
+        std::condition_variable done_cv;
+
+        bool popLocal(size_t index, Task& task){
+            std::lock_guard<std::mutex> lock(queues[index]->mutex);
+            if (queues[index]->tasks.empty()){
+                return false;
+            }
+            task = std::move(queues[index]->tasks.back());
+            queues[index]->tasks.pop_back();
+            return true;
+        }
+
+        bool steal(size_t thief, Task& task){
+            for (size_t n = 1; n < queues.size(); ++n){
+                size_t victim = (thief + n) % queues.size();
+                std::lock_guard<std::mutex> lock(queues[victim]->mutex);
+                if (!queues[victim]->tasks.empty()){
+                    task = std::move(queues[victim]->tasks.front());
+                    queues[victim]->tasks.pop_front();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void workerLoop(size_t index){
+            Task task;
+            for (;;){
+                if (popLocal(index, task) || steal(index, task)){
+                    task();
+                    task = nullptr;
+                    if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1){
+                        std::lock_guard<std::mutex> lock(idle_mutex);
+                        done_cv.notify_all();
+                    }
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(idle_mutex);
+                if (stopping){
+                    return;
+                }
+                // timeout curto cobre a corrida entre submit() e a espera
+                idle_cv.wait_for(lock, std::chrono::milliseconds(1));
+            }
+        }
+};
+
+
+#endif // THREAD_POOL_H
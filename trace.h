@@ -0,0 +1,147 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <array>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <string>
+#include "spsc_ring.h"
+
+
+// formato do arquivo de trace (tudo little-endian, campo a campo, qualquer que seja o host):
+//   cabecalho: "C8TR" + versao (u16) + tamanho do registro (u16)
+//   seguido de registros de TRACE_RECORD_BYTES: pc, opcode, I, v_mask (u16) e V[16]
+const char TRACE_MAGIC[4] = {'C', '8', 'T', 'R'};
+const uint16_t TRACE_VERSION = 1;
+const size_t TRACE_HEADER_BYTES = sizeof(TRACE_MAGIC) + 2 + 2;
+const size_t TRACE_RECORD_BYTES = 4 * 2 + 16;
+
+// um registro por instrucao executada, tamanho fixo
+struct TraceRecord {
+    uint16_t pc;      // endereco da instrucao
+    uint16_t opcode;
+    uint16_t I;       // I depois da instrucao
+    uint16_t v_mask;  // bit n setado => V[n] mudou
+    uint8_t V[16];    // V depois da instrucao (so vale onde v_mask marca)
+};
+
+static_assert(sizeof(TraceRecord) == TRACE_RECORD_BYTES, "TraceRecord deve ter 24 bytes");
+
+inline void putTraceLE16(uint8_t* out, uint16_t value){
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+inline uint16_t getTraceLE16(const uint8_t* data){
+    return static_cast<uint16_t>(data[0] | data[1] << 8);
+}
+
+inline void encodeTraceHeader(uint8_t* out){
+    std::memcpy(out, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    putTraceLE16(out + 4, TRACE_VERSION);
+    putTraceLE16(out + 6, static_cast<uint16_t>(TRACE_RECORD_BYTES));
+}
+
+inline void encodeTraceRecord(const TraceRecord& rec, uint8_t* out){
+    putTraceLE16(out, rec.pc);
+    putTraceLE16(out + 2, rec.opcode);
+    putTraceLE16(out + 4, rec.I);
+    putTraceLE16(out + 6, rec.v_mask);
+    std::memcpy(out + 8, rec.V, sizeof(rec.V));
+}
+
+inline TraceRecord decodeTraceRecord(const uint8_t* data){
+    TraceRecord rec;
+    rec.pc = getTraceLE16(data);
+    rec.opcode = getTraceLE16(data + 2);
+    rec.I = getTraceLE16(data + 4);
+    rec.v_mask = getTraceLE16(data + 6);
+    std::memcpy(rec.V, data + 8, sizeof(rec.V));
+    return rec;
+}
+
+
+// o emulador produz, a thread de escrita consome
+template <size_t CAPACITY>
+using TraceRing = SpscRing<TraceRecord, CAPACITY>;
+
+
+class Tracer {
+    public:
+        Tracer(): file(nullptr), running(false) {}
+
+        ~Tracer(){
+            close();
+        }
+
+        bool open(const std::string& filename){
+            file = std::fopen(filename.c_str(), "wb");
+            if (!file){
+                return false;
+            }
+
+            uint8_t header[TRACE_HEADER_BYTES];
+            encodeTraceHeader(header);
+            std::fwrite(header, 1, sizeof(header), file);
+
+            running.store(true, std::memory_order_release);
+            writer = std::thread(&Tracer::drainLoop, this);
+            return true;
+        }
+
+        void close(){
+            if (writer.joinable()){
+                running.store(false, std::memory_order_release);
+                writer.join();
+            }
+            if (file){
+                std::fclose(file);
+                file = nullptr;
+            }
+        }
+
+        // chamado pelo emulador; nunca perde registro, espera se a fila encher
+        void record(const TraceRecord& rec){
+            while (!ring.push(rec)){
+                std::this_thread::yield();
+            }
+        }
+
+    private:
+        static const size_t RING_CAPACITY = 1 << 16;
+        static const size_t DRAIN_BATCH = 4096;
+
+        TraceRing<RING_CAPACITY> ring;
+        std::FILE* file;
+        std::atomic<bool> running;
+        std::thread writer;
+
+        // a conversao para little-endian fica nesta thread, fora do laco do emulador
+        void drainLoop(){
+            std::vector<TraceRecord> batch(DRAIN_BATCH);
+            std::vector<uint8_t> bytes(DRAIN_BATCH * TRACE_RECORD_BYTES);
+            for (;;){
+                bool stop = !running.load(std::memory_order_acquire);
+                size_t count = ring.pop(batch.data(), batch.size());
+                if (count > 0){
+                    for (size_t n = 0; n < count; ++n){
+                        encodeTraceRecord(batch[n], &bytes[n * TRACE_RECORD_BYTES]);
+                    }
+                    std::fwrite(bytes.data(), TRACE_RECORD_BYTES, count, file);
+                } else if (stop){
+                    break; // fila vazia e pediram pra parar
+                } else {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+            std::fflush(file);
+        }
+};
+
+
+#endif // TRACE_H
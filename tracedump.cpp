@@ -0,0 +1,58 @@
+// chip8-tracedump: converte um trace binario (.c8tr) gerado com CHIP8_TRACE em texto
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include "trace.h"
+
+
+int main(int argc, char* argv[]){
+    if (argc != 2) {
+        std::cerr << "Uso: " << argv[0] << " <arquivo.c8tr>" << std::endl;
+        return 1;
+    }
+
+    std::FILE* file = std::fopen(argv[1], "rb");
+    if (!file) {
+        std::cerr << "Erro: nao foi possivel abrir o trace: " << argv[1] << std::endl;
+        return 1;
+    }
+
+    uint8_t header[TRACE_HEADER_BYTES];
+    if (std::fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        std::memcmp(header, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+        std::cerr << "Erro: arquivo nao e um trace CHIP-8." << std::endl;
+        std::fclose(file);
+        return 1;
+    }
+
+    const uint16_t version = getTraceLE16(header + 4);
+    const uint16_t record_bytes = getTraceLE16(header + 6);
+    if (version != TRACE_VERSION || record_bytes != TRACE_RECORD_BYTES) {
+        std::cerr << "Erro: versao de trace nao suportada (v" << version << ", registro de " << record_bytes << " bytes)." << std::endl;
+        std::fclose(file);
+        return 1;
+    }
+
+    std::vector<uint8_t> batch(4096 * TRACE_RECORD_BYTES);
+    uint64_t total = 0;
+    size_t count;
+    while ((count = std::fread(batch.data(), TRACE_RECORD_BYTES, batch.size() / TRACE_RECORD_BYTES, file)) > 0) {
+        for (size_t n = 0; n < count; ++n) {
+            const TraceRecord rec = decodeTraceRecord(&batch[n * TRACE_RECORD_BYTES]);
+            std::printf("PC: 0x%04X | Opcode: 0x%04X | I: 0x%03X", rec.pc, rec.opcode, rec.I);
+            for (int i = 0; i < 16; ++i) {
+                if (rec.v_mask & (1u << i)) {
+                    std::printf(" | V%X=0x%02X", i, rec.V[i]);
+                }
+            }
+            std::printf("\n");
+        }
+        total += count;
+    }
+
+    std::fclose(file);
+    std::fprintf(stderr, "%llu instrucoes decodificadas.\n", static_cast<unsigned long long>(total));
+    return 0;
+}
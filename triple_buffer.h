@@ -0,0 +1,54 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <cstdint>
+#include <array>
+#include <atomic>
+
+
+// triple buffer lock-free: um escritor publica quadros completos, um leitor
+// pega sempre o mais recente. Nenhum lado espera o outro; quadros que o leitor
+// nao chegou a ver sao simplesmente sobrescritos.
+template <typename T>
+class TripleBuffer {
+    public:
+        // ---- escritor ----
+
+        T& writeBuffer(){
+            return slots[write_index];
+        }
+
+        // troca o slot escrito com o do meio e marca como novo
+        void publish(){
+            uint8_t previous = middle.exchange(static_cast<uint8_t>(write_index | FRESH_BIT), std::memory_order_acq_rel);
+            write_index = previous & INDEX_MASK;
+        }
+
+        // ---- leitor ----
+
+        // true se havia quadro novo; readBuffer() passa a apontar para ele
+        bool update(){
+            if (!(middle.load(std::memory_order_relaxed) & FRESH_BIT)){
+                return false;
+            }
+            uint8_t previous = middle.exchange(read_index, std::memory_order_acq_rel);
+            read_index = previous & INDEX_MASK;
+            return true;
+        }
+
+        const T& readBuffer() const {
+            return slots[read_index];
+        }
+
+    private:
+        static const uint8_t INDEX_MASK = 0x3;
+        static const uint8_t FRESH_BIT = 0x4;
+
+        std::array<T, 3> slots{};
+        alignas(64) uint8_t write_index = 0;
+        alignas(64) std::atomic<uint8_t> middle{1};
+        alignas(64) uint8_t read_index = 2;
+};
+
+
+#endif // TRIPLE_BUFFER_H